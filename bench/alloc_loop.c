@@ -0,0 +1,54 @@
+
+#include "bench.h"
+
+/**
+ * 单线程分配/释放循环：对每个尺寸类别分别测量
+ * 1. pair: 分配一块后立即释放，考察最短的快路径；
+ * 2. lifo: 先连续分配一批，再按相反顺序释放，批的大小超过线程缓存，会经过中心池。
+ * 用法：alloc_loop [轮数的倍数]
+ */
+
+#define BENCH_BATCH     1000
+
+static const size_t bench_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+    320, 384, 448, 512, 640, 768, 896, 1024, 4096, 65536
+};
+
+int
+main(int argc, char **argv) {
+    static void *slots[BENCH_BATCH];
+    int scale = bench_arg(argc, argv, 1, 1);
+    char name[32];
+    size_t i, s, bytes, rounds;
+    uint64_t ns;
+    for (s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); ++s) {
+        bytes = bench_sizes[s];
+        rounds = (bytes <= 1024 ? 2000000 : 200000) * (size_t)scale;
+        ns = bench_now_ns();
+        for (i = 0; i < rounds; ++i) {
+            void *ptr = malloc(bytes);
+            bench_touch(ptr, bytes);
+            free(ptr);
+        }
+        ns = bench_now_ns() - ns;
+        snprintf(name, sizeof(name), "pair/%zu", bytes);
+        bench_report(name, 1, rounds * 2, ns);
+
+        rounds /= BENCH_BATCH;
+        ns = bench_now_ns();
+        while (rounds-- > 0) {
+            for (i = 0; i < BENCH_BATCH; ++i) {
+                slots[i] = malloc(bytes);
+                bench_touch(slots[i], bytes);
+            }
+            for (i = BENCH_BATCH; i-- > 0;)
+                free(slots[i]);
+        }
+        ns = bench_now_ns() - ns;
+        snprintf(name, sizeof(name), "lifo/%zu", bytes);
+        rounds = (bytes <= 1024 ? 2000000 : 200000) * (size_t)scale / BENCH_BATCH;
+        bench_report(name, 1, rounds * BENCH_BATCH * 2, ns);
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+
+#include "bench.h"
+#include "../sty.h"
+
+/**
+ * 区域分配与逐个释放的对比：模拟一次请求处理过程中分配一批16到256字节的对象，请求结束时全部丢
+ * 弃，分别用malloc/free、sty_alloc/sty_free以及sty_arena_alloc/sty_arena_reset完成。此程序
+ * 直接链接sty.c，malloc一项则由LD_PRELOAD决定使用哪个分配器。
+ * 用法：arena [请求数] [每个请求的对象数]
+ */
+
+int
+main(int argc, char **argv) {
+    size_t requests = (size_t)bench_arg(argc, argv, 1, 20000);
+    size_t objects = (size_t)bench_arg(argc, argv, 2, 500);
+    void **objs = (void **)malloc(sizeof(void *) * objects);
+    sty_arena_t *arena = sty_arena_create();
+    uint64_t seed = 1, ns;
+    size_t r, i, bytes;
+
+    ns = bench_now_ns();
+    for (r = 0; r < requests; ++r) {
+        for (i = 0; i < objects; ++i) {
+            bytes = bench_size(&seed, 16, 256);
+            objs[i] = malloc(bytes);
+            bench_touch(objs[i], bytes);
+        }
+        for (i = 0; i < objects; ++i)
+            free(objs[i]);
+    }
+    bench_report("request/malloc", 1, requests * objects, bench_now_ns() - ns);
+
+    ns = bench_now_ns();
+    for (r = 0; r < requests; ++r) {
+        for (i = 0; i < objects; ++i) {
+            bytes = bench_size(&seed, 16, 256);
+            objs[i] = sty_alloc(bytes);
+            bench_touch(objs[i], bytes);
+        }
+        for (i = 0; i < objects; ++i)
+            sty_free(objs[i]);
+    }
+    bench_report("request/sty_alloc", 1, requests * objects, bench_now_ns() - ns);
+
+    ns = bench_now_ns();
+    for (r = 0; r < requests; ++r) {
+        for (i = 0; i < objects; ++i) {
+            bytes = bench_size(&seed, 16, 256);
+            bench_touch(sty_arena_alloc(arena, bytes), bytes);
+        }
+        sty_arena_reset(arena);
+    }
+    bench_report("request/sty_arena", 1, requests * objects, bench_now_ns() - ns);
+
+    sty_arena_destroy(arena);
+    free(objs);
+    return 0;
+}
@@ -0,0 +1,98 @@
+
+#ifndef __STY__BENCH__H__
+#define __STY__BENCH__H__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+/**
+ * 各个基准程序共用的计时、随机数与输出工具。基准程序只调用libc的malloc/free，由bench/run.sh
+ * 通过LD_PRELOAD换入不同的分配器，所以同一个可执行文件可以直接比较glibc、sty、jemalloc与
+ * mimalloc。每个程序每项测试输出一行：
+ *     <测试名> threads=<线程数> ops=<操作数> ns/op=<每次操作的纳秒数> Mops/s=<吞吐> peak_rss_kB=<峰值常驻内存>
+ */
+
+static inline uint64_t
+bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* 进程到目前为止的峰值常驻内存 */
+static inline long
+bench_peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static inline uint64_t
+bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/* [lo, hi]之间的随机大小 */
+static inline size_t
+bench_size(uint64_t *state, size_t lo, size_t hi) {
+    return lo + (size_t)(bench_rand(state) % (hi - lo + 1));
+}
+
+static inline int
+bench_arg(int argc, char **argv, int i, int def) {
+    return argc > i ? atoi(argv[i]) : def;
+}
+
+static inline void
+bench_report(const char *name, int threads, uint64_t ops, uint64_t ns) {
+    printf("%-20s threads=%-3d ops=%-10llu ns/op=%-9.2f Mops/s=%-9.2f peak_rss_kB=%ld\n",
+           name, threads, (unsigned long long)ops, ops != 0 ? (double)ns / (double)ops : 0.0,
+           ns != 0 ? (double)ops * 1e3 / (double)ns : 0.0, bench_peak_rss_kb());
+    fflush(stdout);
+}
+
+/* 启动threads个线程执行fn(args + i * size)，全部结束后返回所用的纳秒数 */
+static inline uint64_t
+bench_run_threads(int threads, void *(*fn)(void *), void *args, size_t size) {
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * (size_t)threads);
+    uint64_t start = bench_now_ns();
+    int i;
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&tids[i], NULL, fn, (char *)args + (size_t)i * size) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    for (i = 0; i < threads; ++i)
+        pthread_join(tids[i], NULL);
+    start = bench_now_ns() - start;
+    free(tids);
+    return start;
+}
+
+/* 让编译器无法把配对的malloc/free优化掉 */
+static void *volatile bench_sink;
+
+static inline void
+bench_touch(void *ptr, size_t bytes) {
+    if (ptr == NULL) {
+        fputs("allocation failed\n", stderr);
+        exit(1);
+    }
+    ((char *)ptr)[0] = (char)bytes;
+    ((char *)ptr)[bytes - 1] = (char)bytes;
+    bench_sink = ptr;
+}
+
+#endif
@@ -0,0 +1,61 @@
+
+#include "bench.h"
+
+/**
+ * Larson服务器模拟：每个线程持有一组槽位，反复随机选取一个槽位，释放其中的对象并换成一个新的
+ * 随机大小的对象。每一轮结束后，这些槽位交给下一轮新创建的线程继续使用，于是大量对象由创建它的
+ * 线程之外的线程释放，与真实服务器中连接在线程间迁移的情形相同。
+ * 用法：larson [线程数] [轮数] [每个线程每轮的操作数]
+ */
+
+#define BENCH_SLOTS     1000
+#define BENCH_MIN       16
+#define BENCH_MAX       512
+
+typedef struct bench_worker {
+    void               *slots[BENCH_SLOTS];
+    uint64_t            seed;
+    size_t              ops;
+} bench_worker;
+
+static void *
+bench_main(void *arg) {
+    bench_worker *w = (bench_worker *)arg;
+    size_t i, slot, bytes;
+    for (i = 0; i < w->ops; ++i) {
+        slot = (size_t)(bench_rand(&w->seed) % BENCH_SLOTS);
+        bytes = bench_size(&w->seed, BENCH_MIN, BENCH_MAX);
+        free(w->slots[slot]);
+        w->slots[slot] = malloc(bytes);
+        bench_touch(w->slots[slot], bytes);
+    }
+    return NULL;
+}
+
+int
+main(int argc, char **argv) {
+    int threads = bench_arg(argc, argv, 1, 1);
+    int rounds = bench_arg(argc, argv, 2, 10);
+    size_t ops = (size_t)bench_arg(argc, argv, 3, 500000), bytes;
+    bench_worker *workers = (bench_worker *)calloc((size_t)threads, sizeof(bench_worker));
+    uint64_t ns = 0;
+    int i, r;
+    size_t j;
+    for (i = 0; i < threads; ++i) {
+        workers[i].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+        workers[i].ops = ops;
+        for (j = 0; j < BENCH_SLOTS; ++j) {
+            bytes = bench_size(&workers[i].seed, BENCH_MIN, BENCH_MAX);
+            workers[i].slots[j] = malloc(bytes);
+            bench_touch(workers[i].slots[j], bytes);
+        }
+    }
+    for (r = 0; r < rounds; ++r)
+        ns += bench_run_threads(threads, bench_main, workers, sizeof(bench_worker));
+    bench_report("larson", threads, (uint64_t)threads * (uint64_t)rounds * ops, ns);
+    for (i = 0; i < threads; ++i)
+        for (j = 0; j < BENCH_SLOTS; ++j)
+            free(workers[i].slots[j]);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,86 @@
+
+#include "bench.h"
+#include <stdatomic.h>
+#include <sched.h>
+
+/**
+ * 生产者-消费者：线程两两配对，生产者分配16到512字节的对象并放入单生产者单消费者的环形队列，
+ * 消费者取出后释放。所有释放都发生在另一个线程中，考察远程释放的开销。
+ * 用法：prodcons [线程数] [每对线程传递的对象数]
+ */
+
+#define BENCH_RING      1024
+
+typedef struct bench_pair {
+    _Alignas(64) _Atomic(size_t) head;
+    _Alignas(64) _Atomic(size_t) tail;
+    void               *ring[BENCH_RING];
+    size_t              count;
+} bench_pair;
+
+static void *
+bench_producer(bench_pair *q) {
+    uint64_t seed = (uintptr_t)q | 1;
+    size_t i, head, bytes;
+    void *ptr;
+    for (i = 0; i < q->count; ++i) {
+        bytes = bench_size(&seed, 16, 512);
+        ptr = malloc(bytes);
+        bench_touch(ptr, bytes);
+        head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        while (head - atomic_load_explicit(&q->tail, memory_order_acquire) == BENCH_RING)
+            sched_yield();
+        q->ring[head % BENCH_RING] = ptr;
+        atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+static void *
+bench_consumer(bench_pair *q) {
+    size_t i, tail;
+    for (i = 0; i < q->count; ++i) {
+        tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        while (atomic_load_explicit(&q->head, memory_order_acquire) == tail)
+            sched_yield();
+        free(q->ring[tail % BENCH_RING]);
+        atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+typedef struct bench_role {
+    bench_pair         *queue;
+    int                 consumer;
+} bench_role;
+
+static void *
+bench_main(void *arg) {
+    bench_role *role = (bench_role *)arg;
+    return role->consumer ? bench_consumer(role->queue) : bench_producer(role->queue);
+}
+
+int
+main(int argc, char **argv) {
+    int threads = bench_arg(argc, argv, 1, 2), pairs, i;
+    size_t count = (size_t)bench_arg(argc, argv, 2, 2000000);
+    bench_pair *queues;
+    bench_role *roles;
+    uint64_t ns;
+    pairs = threads >= 2 ? threads / 2 : 1;
+    queues = (bench_pair *)aligned_alloc(64, sizeof(bench_pair) * (size_t)pairs);
+    roles = (bench_role *)malloc(sizeof(bench_role) * (size_t)pairs * 2);
+    for (i = 0; i < pairs; ++i) {
+        atomic_init(&queues[i].head, 0);
+        atomic_init(&queues[i].tail, 0);
+        queues[i].count = count;
+        roles[2 * i].queue = roles[2 * i + 1].queue = &queues[i];
+        roles[2 * i].consumer = 0;
+        roles[2 * i + 1].consumer = 1;
+    }
+    ns = bench_run_threads(pairs * 2, bench_main, roles, sizeof(bench_role));
+    bench_report("prodcons", pairs * 2, (uint64_t)count * (uint64_t)pairs, ns);
+    free(roles);
+    free(queues);
+    return 0;
+}
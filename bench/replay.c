@@ -0,0 +1,301 @@
+
+#include "bench.h"
+#include "../core/sty_trace.h"
+#include <stdatomic.h>
+#include <sched.h>
+
+/**
+ * 重放sty_trace_start记录下的分配轨迹。轨迹先按时间排序，地址被换成从0开始编号的对象，之后每个
+ * 被记录的线程由一个重放线程按原来的顺序调用malloc、calloc、realloc、posix_memalign与free；由
+ * 别的线程分配的对象要等它真正被分配之后才会被释放。与其他基准程序一样，分配器由LD_PRELOAD
+ * 决定，所以同一份轨迹可以比较glibc、sty、jemalloc与mimalloc，或者比较sty的不同编译选项。
+ * 用法：replay <轨迹文件> [serial]，serial表示在一个线程中按全局时间顺序重放。
+ */
+
+typedef struct bench_event {
+    uint64_t            time;
+    uint64_t            seq;            /* 同一时刻的事件保持读入的顺序 */
+    uint64_t            ptr;
+    uint64_t            old;
+    uint64_t            bytes;
+    uint64_t            align;
+    uint32_t            thread;
+    uint32_t            type;
+} bench_event;
+
+typedef struct bench_op {
+    uint32_t            type;
+    uint32_t            slot;           /* 结果存放的对象 */
+    uint32_t            src;            /* realloc的原对象 */
+    uint32_t            align;
+    uint64_t            bytes;
+} bench_op;
+
+typedef struct bench_thread {
+    bench_op           *ops;
+    size_t              count;
+    size_t              cap;
+} bench_thread;
+
+static void *_Atomic    *bench_slots;
+
+static int
+bench_varint(const unsigned char **p, const unsigned char *end, uint64_t *value) {
+    uint64_t v = 0;
+    unsigned shift = 0;
+    while (*p < end && shift < 64) {
+        unsigned char c = *(*p)++;
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            *value = v;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+static int
+bench_event_cmp(const void *a, const void *b) {
+    const bench_event *x = (const bench_event *)a, *y = (const bench_event *)b;
+    if (x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/* 读入整个轨迹文件并解码出全部事件 */
+static bench_event *
+bench_load(const char *path, size_t *count, uint32_t *threads) {
+    FILE *file = fopen(path, "rb");
+    unsigned char *data = NULL;
+    const unsigned char *p, *end, *chunk;
+    bench_event *events = NULL, *e;
+    size_t len = 0, cap = 0, n = 0, size;
+    uint64_t thread, base, bytes, dt, type;
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    for (;;) {
+        if (len == cap) {
+            cap = cap != 0 ? cap * 2 : 1 << 20;
+            data = (unsigned char *)realloc(data, cap);
+        }
+        if ((size = fread(data + len, 1, cap - len, file)) == 0)
+            break;
+        len += size;
+    }
+    fclose(file);
+    if (len < sizeof(STY_TRACE_MAGIC) - 1 || memcmp(data, STY_TRACE_MAGIC, sizeof(STY_TRACE_MAGIC) - 1) != 0) {
+        fprintf(stderr, "%s: not a sty trace\n", path);
+        exit(1);
+    }
+    cap = 0;
+    *threads = 0;
+    p = data + sizeof(STY_TRACE_MAGIC) - 1;
+    end = data + len;
+    while (p < end) {
+        if (bench_varint(&p, end, &thread) || bench_varint(&p, end, &base)
+            || bench_varint(&p, end, &bytes) || bytes > (uint64_t)(end - p))
+            break;
+        if (thread > *threads)
+            *threads = (uint32_t)thread;
+        chunk = p + bytes;
+        while (p < chunk) {
+            if (n == cap) {
+                cap = cap != 0 ? cap * 2 : 1 << 16;
+                events = (bench_event *)realloc(events, cap * sizeof(bench_event));
+            }
+            e = &events[n];
+            memset(e, 0, sizeof(*e));
+            type = *p++;
+            if (bench_varint(&p, chunk, &dt))
+                break;
+            base += dt;
+            if ((type == STY_TRACE_REALLOC && bench_varint(&p, chunk, &e->old))
+                || (type == STY_TRACE_ALIGNED && bench_varint(&p, chunk, &e->align))
+                || (type != STY_TRACE_FREE && bench_varint(&p, chunk, &e->bytes))
+                || bench_varint(&p, chunk, &e->ptr) || type > STY_TRACE_CALLOC)
+                break;
+            e->time = base;
+            e->seq = n;
+            e->thread = (uint32_t)thread;
+            e->type = (uint32_t)type;
+            ++n;
+        }
+        p = chunk;
+    }
+    free(data);
+    qsort(events, n, sizeof(bench_event), bench_event_cmp);
+    *count = n;
+    return events;
+}
+
+/* 地址到对象编号的开放寻址散列表，删除时留下墓碑 */
+typedef struct bench_map {
+    uint64_t           *keys;           /* 0为空，UINT64_MAX为墓碑 */
+    uint32_t           *slots;
+    size_t              mask;
+} bench_map;
+
+static size_t
+bench_map_find(bench_map *m, uint64_t key, int insert) {
+    size_t i = (size_t)(key * 0x9E3779B97F4A7C15ull) & m->mask, tomb = SIZE_MAX;
+    for (;; i = (i + 1) & m->mask) {
+        if (m->keys[i] == 0)
+            return insert && tomb != SIZE_MAX ? tomb : i;
+        if (m->keys[i] == UINT64_MAX) {
+            if (tomb == SIZE_MAX)
+                tomb = i;
+        } else if (m->keys[i] == key) {
+            return i;
+        }
+    }
+}
+
+/* 取出key当前对应的对象并从表中删除，不存在时返回UINT32_MAX */
+static uint32_t
+bench_map_take(bench_map *m, uint64_t key) {
+    size_t i = bench_map_find(m, key + 1, 0);
+    if (m->keys[i] != key + 1)
+        return UINT32_MAX;
+    m->keys[i] = UINT64_MAX;
+    return m->slots[i];
+}
+
+static void
+bench_map_put(bench_map *m, uint64_t key, uint32_t slot) {
+    size_t i = bench_map_find(m, key + 1, 1);
+    m->keys[i] = key + 1;
+    m->slots[i] = slot;
+}
+
+static void
+bench_push(bench_thread *t, bench_op op) {
+    if (t->count == t->cap) {
+        t->cap = t->cap != 0 ? t->cap * 2 : 1024;
+        t->ops = (bench_op *)realloc(t->ops, t->cap * sizeof(bench_op));
+    }
+    t->ops[t->count++] = op;
+}
+
+/* 其他线程分配的对象可能尚未被重放 */
+static void *
+bench_wait(uint32_t slot) {
+    void *ptr;
+    while ((ptr = atomic_load_explicit(&bench_slots[slot], memory_order_acquire)) == NULL)
+        sched_yield();
+    return ptr;
+}
+
+static void
+bench_exec(const bench_op *op) {
+    void *ptr = NULL;
+    size_t bytes = (size_t)op->bytes;
+    switch (op->type) {
+    case STY_TRACE_ALLOC:
+        ptr = malloc(bytes);
+        break;
+    case STY_TRACE_CALLOC:
+        ptr = calloc(1, bytes);
+        break;
+    case STY_TRACE_ALIGNED:
+        if (posix_memalign(&ptr, op->align, bytes) != 0)
+            ptr = NULL;
+        break;
+    case STY_TRACE_REALLOC:
+        ptr = realloc(bench_wait(op->src), bytes);
+        atomic_store_explicit(&bench_slots[op->src], NULL, memory_order_relaxed);
+        break;
+    case STY_TRACE_FREE:
+        free(bench_wait(op->slot));
+        atomic_store_explicit(&bench_slots[op->slot], NULL, memory_order_relaxed);
+        return;
+    }
+    if (ptr == NULL && bytes != 0) {
+        fputs("allocation failed\n", stderr);
+        exit(1);
+    }
+    if (bytes != 0)
+        ((char *)ptr)[0] = 1;
+    else if (ptr == NULL)
+        ptr = malloc(1);
+    atomic_store_explicit(&bench_slots[op->slot], ptr, memory_order_release);
+}
+
+static void *
+bench_main(void *arg) {
+    bench_thread *t = (bench_thread *)arg;
+    size_t i;
+    for (i = 0; i < t->count; ++i)
+        bench_exec(&t->ops[i]);
+    return NULL;
+}
+
+int
+main(int argc, char **argv) {
+    bench_thread *threads, serial = { NULL, 0, 0 };
+    bench_map map;
+    bench_event *events;
+    bench_op op;
+    size_t count, i, ops = 0;
+    uint32_t nthreads, slots = 0, slot;
+    uint64_t ns;
+    int use_serial = argc > 2 && strcmp(argv[2], "serial") == 0, active = 0;
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace> [serial]\n", argv[0]);
+        return 2;
+    }
+    events = bench_load(argv[1], &count, &nthreads);
+    threads = (bench_thread *)calloc((size_t)nthreads + 1, sizeof(bench_thread));
+    for (map.mask = 1024; map.mask < count * 2; map.mask <<= 1)
+        ;
+    map.keys = (uint64_t *)calloc(map.mask, sizeof(uint64_t));
+    map.slots = (uint32_t *)malloc(map.mask * sizeof(uint32_t));
+    --map.mask;
+    /* 按全局时间顺序把地址换成对象编号；轨迹开始之前分配的对象的释放被丢弃 */
+    for (i = 0; i < count; ++i) {
+        bench_event *e = &events[i];
+        memset(&op, 0, sizeof(op));
+        op.type = e->type;
+        op.bytes = e->bytes;
+        op.align = (uint32_t)e->align;
+        if (e->type == STY_TRACE_FREE) {
+            if ((op.slot = bench_map_take(&map, e->ptr)) == UINT32_MAX)
+                continue;
+        } else {
+            if (e->type == STY_TRACE_REALLOC && (op.src = bench_map_take(&map, e->old)) == UINT32_MAX)
+                op.type = STY_TRACE_ALLOC;
+            op.slot = slots++;
+            bench_map_put(&map, e->ptr, op.slot);
+        }
+        bench_push(use_serial ? &serial : &threads[e->thread], op);
+        ++ops;
+    }
+    free(events);
+    free(map.keys);
+    free(map.slots);
+    bench_slots = (void *_Atomic *)calloc((size_t)slots + 1, sizeof(void *));
+    if (use_serial) {
+        ns = bench_now_ns();
+        bench_main(&serial);
+        ns = bench_now_ns() - ns;
+        active = 1;
+    } else {
+        /* 只为有事件的线程创建重放线程 */
+        for (i = 0; i <= nthreads; ++i)
+            if (threads[i].count != 0)
+                threads[active++] = threads[i];
+        ns = bench_run_threads(active, bench_main, threads, sizeof(bench_thread));
+    }
+    bench_report(use_serial ? "replay/serial" : "replay", active, ops, ns);
+    /* 轨迹结束时仍然存活的对象 */
+    for (slot = 0; slot < slots; ++slot)
+        free(bench_slots[slot]);
+    for (i = 0; !use_serial && i < (size_t)active; ++i)
+        free(threads[i].ops);
+    free(threads);
+    free(serial.ops);
+    free((void *)bench_slots);
+    return 0;
+}
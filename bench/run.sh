@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# 编译并运行bench/下的全部基准程序，结果写入仓库根目录的bench_output.txt。
+# 基准程序只调用malloc/free，每个分配器通过LD_PRELOAD换入：
+#   glibc       不预加载任何库
+#   sty         以STY_OVERRIDE编译的libsty_malloc.so
+#   jemalloc    $JEMALLOC，未设置时在常见的库目录中查找libjemalloc.so
+#   mimalloc    $MIMALLOC，未设置时在常见的库目录中查找libmimalloc.so
+# 找不到的分配器被跳过。多线程测试的线程数从1开始翻倍，直到$THREADS(默认为CPU数)。
+# 设置$TRACE时还会用replay重放这个由sty_trace_start记录的轨迹文件。
+#
+# 用法：bench/run.sh [输出文件]
+set -e
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+build=${BUILD:-$root/_bench_build}
+output=${1:-$root/bench_output.txt}
+cc=${CC:-cc}
+cxx=${CXX:-c++}
+cflags=${CFLAGS:--O2 -g -fno-omit-frame-pointer}
+threads=${THREADS:-$(nproc 2>/dev/null || echo 1)}
+
+mkdir -p "$build"
+$cc $cflags -std=c11 -fPIC -DSTY_OVERRIDE -c "$root/sty.c" -o "$build/sty_override.o"
+$cxx $cflags -fPIC -fsized-deallocation -c "$root/sty_new.cpp" -o "$build/sty_new.o"
+$cxx -shared -o "$build/libsty_malloc.so" "$build/sty_override.o" "$build/sty_new.o" -lpthread -lm
+for prog in alloc_loop prodcons larson threadtest xmalloc_test replay; do
+    $cc $cflags -std=c11 -o "$build/$prog" "$root/bench/$prog.c" -lpthread
+done
+$cc $cflags -std=c11 -o "$build/arena" "$root/bench/arena.c" "$root/sty.c" -lpthread -lm
+
+find_lib() {
+    for dir in /usr/local/lib /usr/lib /usr/lib64 /usr/lib/x86_64-linux-gnu /usr/lib/aarch64-linux-gnu; do
+        for lib in "$dir/$1.so" "$dir/$1.so."*; do
+            if [ -f "$lib" ]; then
+                echo "$lib"
+                return
+            fi
+        done
+    done
+}
+
+allocators="glibc= sty=$build/libsty_malloc.so"
+jemalloc=${JEMALLOC:-$(find_lib libjemalloc)}
+mimalloc=${MIMALLOC:-$(find_lib libmimalloc)}
+[ -n "$jemalloc" ] && allocators="$allocators jemalloc=$jemalloc"
+[ -n "$mimalloc" ] && allocators="$allocators mimalloc=$mimalloc"
+
+counts=1
+n=2
+while [ "$n" -le "$threads" ]; do
+    counts="$counts $n"
+    n=$((n * 2))
+done
+case " $counts " in
+    *" $threads "*) ;;
+    *) counts="$counts $threads" ;;
+esac
+
+run() {
+    name=$1
+    lib=$2
+    shift 2
+    LD_PRELOAD=$lib "$@" | sed "s/^/$(printf '%-9s' "$name") /"
+}
+
+{
+    echo "# $(date -u '+%Y-%m-%d %H:%M:%S UTC') $(uname -srm), $(nproc 2>/dev/null || echo '?') CPUs"
+    echo "# allocators: $allocators"
+    for entry in $allocators; do
+        name=${entry%%=*}
+        lib=${entry#*=}
+        run "$name" "$lib" "$build/alloc_loop"
+        run "$name" "$lib" "$build/arena"
+        for t in $counts; do
+            run "$name" "$lib" "$build/threadtest" "$t"
+            run "$name" "$lib" "$build/larson" "$t"
+            run "$name" "$lib" "$build/xmalloc_test" "$t"
+            if [ "$t" -ge 2 ]; then
+                run "$name" "$lib" "$build/prodcons" "$t"
+            fi
+        done
+        if [ -n "$TRACE" ]; then
+            run "$name" "$lib" "$build/replay" "$TRACE"
+            run "$name" "$lib" "$build/replay" "$TRACE" serial
+        fi
+    done
+} | tee "$output"
@@ -0,0 +1,51 @@
+
+#include "bench.h"
+
+/**
+ * Hoard的threadtest：每个线程独立地反复分配一批对象再全部释放，线程之间不共享任何对象，考察
+ * 分配器随线程数增加的扩展性以及是否存在伪共享。
+ * 用法：threadtest [线程数] [每个线程的轮数] [每批的对象数] [对象的字节数]
+ */
+
+typedef struct bench_worker {
+    size_t              rounds;
+    size_t              batch;
+    size_t              bytes;
+    char                pad[64];
+} bench_worker;
+
+static void *
+bench_main(void *arg) {
+    bench_worker *w = (bench_worker *)arg;
+    void **objs = (void **)malloc(sizeof(void *) * w->batch);
+    size_t r, i;
+    for (r = 0; r < w->rounds; ++r) {
+        for (i = 0; i < w->batch; ++i) {
+            objs[i] = malloc(w->bytes);
+            bench_touch(objs[i], w->bytes);
+        }
+        for (i = 0; i < w->batch; ++i)
+            free(objs[i]);
+    }
+    free(objs);
+    return NULL;
+}
+
+int
+main(int argc, char **argv) {
+    int threads = bench_arg(argc, argv, 1, 1), i;
+    size_t rounds = (size_t)bench_arg(argc, argv, 2, 2000);
+    size_t batch = (size_t)bench_arg(argc, argv, 3, 1000);
+    size_t bytes = (size_t)bench_arg(argc, argv, 4, 64);
+    bench_worker *workers = (bench_worker *)calloc((size_t)threads, sizeof(bench_worker));
+    uint64_t ns;
+    for (i = 0; i < threads; ++i) {
+        workers[i].rounds = rounds;
+        workers[i].batch = batch;
+        workers[i].bytes = bytes;
+    }
+    ns = bench_run_threads(threads, bench_main, workers, sizeof(bench_worker));
+    bench_report("threadtest", threads, (uint64_t)threads * rounds * batch * 2, ns);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,87 @@
+
+#include "bench.h"
+
+/**
+ * xmalloc-test：每个线程分配一批随机大小的对象，把整批放入全局的共享队列，再从队首取出最早放入
+ * 的一批(通常来自别的线程)并全部释放。与prodcons的一对一不同，这里是多对多的远程释放。队列中至
+ * 少保留BENCH_DEPTH批，使每一批在被释放之前经过足够多的其他线程的分配。ops统计的是分配的次数。
+ * 用法：xmalloc_test [线程数] [每个线程的批数]
+ */
+
+#define BENCH_BATCH     100
+#define BENCH_DEPTH     64
+
+typedef struct bench_batch {
+    struct bench_batch *next;
+    void               *objs[BENCH_BATCH];
+} bench_batch;
+
+static pthread_mutex_t  bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static bench_batch     *bench_head;
+static bench_batch     *bench_tail;
+static size_t           bench_depth;
+
+typedef struct bench_worker {
+    size_t              batches;
+    uint64_t            seed;
+    char                pad[64];
+} bench_worker;
+
+static void *
+bench_main(void *arg) {
+    bench_worker *w = (bench_worker *)arg;
+    bench_batch *b;
+    size_t n, i, bytes;
+    for (n = 0; n < w->batches; ++n) {
+        b = (bench_batch *)malloc(sizeof(bench_batch));
+        bench_touch(b, sizeof(bench_batch));
+        for (i = 0; i < BENCH_BATCH; ++i) {
+            bytes = bench_size(&w->seed, 16, 1024);
+            b->objs[i] = malloc(bytes);
+            bench_touch(b->objs[i], bytes);
+        }
+        b->next = NULL;
+        pthread_mutex_lock(&bench_lock);
+        if (bench_tail != NULL)
+            bench_tail->next = b;
+        else
+            bench_head = b;
+        bench_tail = b;
+        b = NULL;
+        if (++bench_depth > BENCH_DEPTH) {
+            b = bench_head;
+            bench_head = b->next;
+            --bench_depth;
+        }
+        pthread_mutex_unlock(&bench_lock);
+        if (b == NULL)
+            continue;
+        for (i = 0; i < BENCH_BATCH; ++i)
+            free(b->objs[i]);
+        free(b);
+    }
+    return NULL;
+}
+
+int
+main(int argc, char **argv) {
+    int threads = bench_arg(argc, argv, 1, 1), i;
+    size_t batches = (size_t)bench_arg(argc, argv, 2, 20000);
+    bench_worker *workers = (bench_worker *)calloc((size_t)threads, sizeof(bench_worker));
+    bench_batch *b;
+    uint64_t ns;
+    for (i = 0; i < threads; ++i) {
+        workers[i].batches = batches;
+        workers[i].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+    }
+    ns = bench_run_threads(threads, bench_main, workers, sizeof(bench_worker));
+    bench_report("xmalloc-test", threads, (uint64_t)threads * batches * (BENCH_BATCH + 1), ns);
+    while ((b = bench_head) != NULL) {
+        bench_head = b->next;
+        for (i = 0; i < BENCH_BATCH; ++i)
+            free(b->objs[i]);
+        free(b);
+    }
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,284 @@
+
+#ifndef __STY__ALLOCATOR__H__
+#define __STY__ALLOCATOR__H__
+#include "sty_memory.h"
+#include "sty_class.h"
+#include "sty_arena.h"
+#include "sty_heap.h"
+#ifdef  __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#if __cplusplus > 202002L
+#include <memory>
+#endif
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define STY_HAVE_PMR    1
+#endif
+#endif
+
+namespace sty {
+
+/**
+ * 满足标准库Allocator要求的分配器，使std::vector、std::unordered_map等容器直接使用sty_alloc。
+ * 释放时容器总会给出元素个数，所以走sty_free_sized，跳过对内存元数据的访问。
+ * 
+ * @author          bjut-zky
+ * @brief           基于sty_alloc的标准库分配器。
+ */
+template <typename T>
+class allocator {
+public:
+    typedef T               value_type;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef allocator<U> other;
+    };
+
+    allocator() noexcept {}
+
+    template <typename U>
+    allocator(const allocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        /* std::map、std::list等基于节点的容器每次只分配一个元素，尺寸类别在编译期确定 */
+        if (n == 1 && alignof(T) <= 16)
+            return static_cast<T *>(sty::alloc<sizeof(T)>());
+        if (n > SIZE_MAX / sizeof(T))
+            throw std::bad_alloc();
+        if (alignof(T) > 16)
+            return static_cast<T *>(sty_alloc_aligned(alignof(T), n * sizeof(T)));
+        return static_cast<T *>(sty_alloc(n * sizeof(T)));
+    }
+
+#ifdef __cpp_lib_allocate_at_least
+    /* 尺寸类别取整多出的空间同样交给容器，deallocate时容器给出的是这里返回的个数 */
+    std::allocation_result<T *> allocate_at_least(std::size_t n) {
+        std::size_t actual;
+        T *ptr;
+        if (alignof(T) > 16)
+            return {allocate(n), n};
+        if (n > SIZE_MAX / sizeof(T))
+            throw std::bad_alloc();
+        ptr = static_cast<T *>(sty_alloc_at_least(n * sizeof(T), &actual));
+        return {ptr, actual / sizeof(T)};
+    }
+#endif
+
+    void deallocate(T *ptr, std::size_t n) noexcept {
+        /* 对齐分配可能落在更大的尺寸类别中，只能由sty_free找回 */
+        if (alignof(T) > 16)
+            sty_free(ptr);
+        else
+            sty_free_sized(ptr, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const allocator<T> &, const allocator<U> &) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const allocator<T> &, const allocator<U> &) noexcept {
+    return false;
+}
+
+/**
+ * 从sty_arena_t中分配的标准库分配器。deallocate什么也不做，内存随区域的重置或销毁一并释放，
+ * 适合生命周期与一次请求相同的临时容器。分配器不拥有区域。
+ * 
+ * @author          bjut-zky
+ * @brief           基于sty_arena_t的标准库分配器。
+ */
+template <typename T>
+class arena_allocator {
+public:
+    typedef T               value_type;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef arena_allocator<U> other;
+    };
+
+    explicit arena_allocator(sty_arena_t *arena) noexcept : arena_(arena) {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U> &other) noexcept : arena_(other.arena()) {}
+
+    T *allocate(std::size_t n) {
+        if (n > (SIZE_MAX - alignof(T)) / sizeof(T))
+            throw std::bad_alloc();
+        if (alignof(T) <= 16)
+            return static_cast<T *>(sty_arena_alloc(arena_, n * sizeof(T)));
+        std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(sty_arena_alloc(arena_, n * sizeof(T) + alignof(T)));
+        return reinterpret_cast<T *>((raw + alignof(T) - 1) & ~(std::uintptr_t)(alignof(T) - 1));
+    }
+
+    void deallocate(T *, std::size_t) noexcept {}
+
+    sty_arena_t *arena() const noexcept {
+        return arena_;
+    }
+
+private:
+    sty_arena_t *arena_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const arena_allocator<T> &a, const arena_allocator<U> &b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const arena_allocator<T> &a, const arena_allocator<U> &b) noexcept {
+    return a.arena() != b.arena();
+}
+
+/**
+ * 从sty_heap_t中分配的标准库分配器，使一个分片的容器与它的其他对象共用同一个堆，销毁堆时一并
+ * 释放。分配器不拥有堆，同一个堆的分配仍然必须由调用者串行化。
+ * 
+ * @author          bjut-zky
+ * @brief           基于sty_heap_t的标准库分配器。
+ */
+template <typename T>
+class heap_allocator {
+public:
+    static_assert(alignof(T) <= 16, "sty::heap_allocator only guarantees 16-byte alignment");
+
+    typedef T               value_type;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef heap_allocator<U> other;
+    };
+
+    explicit heap_allocator(sty_heap_t *heap) noexcept : heap_(heap) {}
+
+    template <typename U>
+    heap_allocator(const heap_allocator<U> &other) noexcept : heap_(other.heap()) {}
+
+    T *allocate(std::size_t n) {
+        if (n > SIZE_MAX / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T *>(sty_heap_alloc(heap_, n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept {
+        sty_free_sized(ptr, n * sizeof(T));
+    }
+
+    sty_heap_t *heap() const noexcept {
+        return heap_;
+    }
+
+private:
+    sty_heap_t *heap_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const heap_allocator<T> &a, const heap_allocator<U> &b) noexcept {
+    return a.heap() == b.heap();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const heap_allocator<T> &a, const heap_allocator<U> &b) noexcept {
+    return a.heap() != b.heap();
+}
+
+#ifdef STY_HAVE_PMR
+/**
+ * 基于sty_alloc的std::pmr::memory_resource，供std::pmr容器使用。所有实例彼此等价。
+ * 
+ * @see             sty::get_memory_resource
+ * @author          bjut-zky
+ * @brief           基于sty_alloc的多态内存资源。
+ */
+class memory_resource : public std::pmr::memory_resource {
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        if (align > 16)
+            return sty_alloc_aligned(align, bytes);
+        return sty_alloc(bytes);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t align) override {
+        if (align > 16)
+            sty_free(ptr);
+        else
+            sty_free_sized(ptr, bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return dynamic_cast<const memory_resource *>(&other) != nullptr;
+    }
+};
+
+/**
+ * 返回进程内唯一的sty::memory_resource实例，可直接传给std::pmr::set_default_resource。
+ */
+inline std::pmr::memory_resource *get_memory_resource() noexcept {
+    static memory_resource resource;
+    return &resource;
+}
+
+/**
+ * 拥有一个sty_arena_t的std::pmr::memory_resource。deallocate什么也不做，release重置区域，
+ * 析构时销毁区域。
+ * 
+ * @author          bjut-zky
+ * @brief           基于sty_arena_t的多态内存资源。
+ */
+class arena_resource : public std::pmr::memory_resource {
+public:
+    arena_resource() : arena_(sty_arena_create()) {}
+
+    ~arena_resource() override {
+        sty_arena_destroy(arena_);
+    }
+
+    arena_resource(const arena_resource &) = delete;
+    arena_resource &operator=(const arena_resource &) = delete;
+
+    void release() noexcept {
+        sty_arena_reset(arena_);
+    }
+
+    sty_arena_t *arena() const noexcept {
+        return arena_;
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        if (align <= 16)
+            return sty_arena_alloc(arena_, bytes);
+        if (bytes > SIZE_MAX - align)
+            throw std::bad_alloc();
+        std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(sty_arena_alloc(arena_, bytes + align));
+        return reinterpret_cast<void *>((raw + align - 1) & ~(std::uintptr_t)(align - 1));
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    sty_arena_t *arena_;
+};
+#endif
+
+}
+#endif
+#endif
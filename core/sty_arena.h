@@ -0,0 +1,68 @@
+
+#ifndef __STY__ARENA__H__
+#define __STY__ARENA__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+typedef struct sty_arena sty_arena_t;
+
+/**
+ * 许多场景下，一批小对象拥有相同的生命周期，例如一次请求处理过程中分配的所有对象会在请求结束
+ * 时被一起丢弃。为此逐个调用sty_free既繁琐又浪费。sty_arena_t正是为此而设计：它从sty_alloc
+ * 的页源中成块地取得内存，分配只是一次指针递增，所有对象通过一次sty_arena_reset或
+ * sty_arena_destroy一并释放。
+ * 
+ * @note            sty_arena_t不是线程安全的，同一个区域不应被多个线程同时使用。
+ * @note            sty_arena_create获得的区域务必由sty_arena_destroy销毁。
+ * @see             sty_arena_destroy
+ * @brief           此函数创建一个空的内存区域。
+ * @author          bjut-zky
+ * @return sty_arena_t* 新创建的区域。此函数不会返回NULL。
+ */
+STY_API sty_arena_t * STY_CDCEL STY_IMPORT
+sty_arena_create(void);
+
+/**
+ * 此函数从区域中分配一段连续的内存，起始地址按16字节对齐。得到的内存不能由sty_free释放，只能
+ * 随区域的sty_arena_reset或sty_arena_destroy一起释放。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数从区域中分配一块至少能容纳bytes个字节的内存。
+ * @see             sty_arena_reset
+ * @param arena     由sty_arena_create得到的区域。
+ * @param bytes     指定大小的字节数。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_arena_alloc(sty_arena_t *arena, size_t bytes);
+
+/**
+ * 此函数一次性释放区域中分配的所有内存，但保留区域已经取得的内存块以供后续分配复用，所以其开
+ * 销与区域中分配过多少对象无关。超过内存块大小的单个请求独占一段内存，这部分内存在重置时直接
+ * 还给页源。
+ * 
+ * @note            重置之后，之前从该区域分配的所有内存都不再可用。
+ * @author          bjut-zky
+ * @brief           此函数释放区域中分配的所有内存。
+ * @param arena     由sty_arena_create得到的区域。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_arena_reset(sty_arena_t *arena);
+
+/**
+ * 此函数销毁一个区域，并把它取得的全部内存还给页源。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数销毁一个区域。
+ * @see             sty_arena_create
+ * @param arena     由sty_arena_create得到的区域。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_arena_destroy(sty_arena_t *arena);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,107 @@
+
+#ifndef __STY__CLASS__H__
+#define __STY__CLASS__H__
+#include "sty_types.h"
+#include "sty_memory.h"
+#ifdef  __cplusplus
+#include <cstddef>
+#include <type_traits>
+extern "C" {
+#endif
+
+#define STY_CLASS_COUNT             20
+#define STY_CLASS_MAX               1024
+
+/**
+ * bytes所属的尺寸类别，与sty.c中的尺寸类别表一致：16字节步长直到128字节，此后每翻一倍再细分
+ * 为4档，直到STY_CLASS_MAX。bytes为常量时整个表达式是一个常量表达式，可以用于数组长度、
+ * _Static_assert或C++的模板参数。bytes大于STY_CLASS_MAX时结果没有意义。
+ */
+#define STY_SIZE_CLASS(bytes)                                               \
+    ((bytes) <= 128 ? ((bytes) - ((bytes) != 0)) >> 4 :                     \
+     (bytes) <= 256 ? 8 + (((bytes) - 129) >> 5) :                          \
+     (bytes) <= 512 ? 12 + (((bytes) - 257) >> 6) :                         \
+                      16 + (((bytes) - 513) >> 7))
+
+/**
+ * 此函数直接从cls类别的线程缓存中分配一个对象，跳过由大小查询尺寸类别的一步。cls通常由
+ * STY_SIZE_CLASS或sty_size_class在编译期算出，见sty_alloc_const与sty::alloc<N>。
+ *
+ * @note            cls必须小于STY_CLASS_COUNT。以STY_DEBUG编译时会检查cls，超出范围时结束进程。
+ * @note            得到的对象可用的字节数为cls类别的大小，务必由sty_free或以不超过该大小的
+ *                  字节数调用sty_free_sized释放。
+ * @see             sty_alloc
+ * @brief           此函数从指定的尺寸类别中分配一块堆内存。
+ * @author          bjut-zky
+ * @param cls       尺寸类别的编号。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_alloc_class(unsigned cls);
+
+#ifdef  __cplusplus
+}
+#define STY_CONSTEXPR               constexpr
+#else
+#define STY_CONSTEXPR
+#endif
+
+/**
+ * STY_SIZE_CLASS的函数形式，在C++中是constexpr函数。
+ *
+ * @author          bjut-zky
+ * @brief           此函数计算bytes所属的尺寸类别。
+ * @param bytes     不大于STY_CLASS_MAX的字节数。
+ * @return unsigned 尺寸类别的编号。
+ */
+static inline STY_CONSTEXPR unsigned
+sty_size_class(size_t bytes) {
+    return (unsigned)STY_SIZE_CLASS(bytes);
+}
+
+/**
+ * 与sty_alloc等价，但bytes为编译期常量时(例如sizeof(T))，是否属于小对象以及所属的尺寸类别都在
+ * 编译期确定，运行时只剩一次sty_alloc_class调用。
+ *
+ * @see             sty_alloc_class
+ * @brief           此函数为常量大小的请求分配一块堆内存。
+ * @author          bjut-zky
+ * @param bytes     指定大小的字节数。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+static inline void *
+sty_alloc_const(size_t bytes) {
+    return bytes <= STY_CLASS_MAX ? sty_alloc_class(sty_size_class(bytes)) : sty_alloc(bytes);
+}
+
+#ifdef  __cplusplus
+namespace sty {
+
+/**
+ * 分配N字节。N不超过STY_CLASS_MAX时尺寸类别作为模板实参在编译期算出，否则退回sty_alloc。
+ *
+ * @see             sty::free
+ * @author          bjut-zky
+ * @brief           此函数为编译期已知大小的请求分配一块堆内存。
+ */
+template <std::size_t N>
+inline void *alloc() {
+    return N <= STY_CLASS_MAX
+        ? sty_alloc_class(std::integral_constant<unsigned, sty_size_class(N <= STY_CLASS_MAX ? N : 0)>::value)
+        : sty_alloc(N);
+}
+
+/**
+ * 释放由sty::alloc<N>得到的内存。
+ *
+ * @author          bjut-zky
+ * @brief           此函数释放编译期已知大小的一块堆内存。
+ */
+template <std::size_t N>
+inline void free(void *ptr) {
+    sty_free_sized(ptr, N);
+}
+
+}
+#endif
+#endif
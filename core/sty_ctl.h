@@ -0,0 +1,49 @@
+
+#ifndef __STY__CTL__H__
+#define __STY__CTL__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 此函数按名字读取或修改分配器的一个参数，使同一个二进制文件可以按部署调整或对比不同的设置，
+ * 而不必为此重新编译。参数的值总是以下表中给出的类型传递：
+ *     名字            类型     说明
+ *     decay_ms        long     同sty_decay_time
+ *     hugepages       int      同sty_hugepage_policy
+ *     rss_limit       size_t   同sty_rss_limit
+ *     dontfork        int      同sty_purge_dontfork
+ *     oom_retry       int      没有注册内存耗尽处理函数时的重试次数，默认为STY_ALLOC_FAILED_RETRY
+ *     tcache_max      size_t   每个尺寸类别在线程缓存中最多保留的对象个数，不足一个对象批时按一
+ *                              个对象批计算；0表示两个对象批，这是默认值
+ *     span_cache      size_t   每个堆的页源最多缓存的空闲span个数，默认为64
+ *     large_direct    size_t   超过此字节数的大对象独占一段映射，默认为16 MiB
+ *     pool_slab_min   size_t   对象池每次向页源或sty_alloc申请的slab至少容纳的对象个数，默认为16
+ *     batch_bytes     size_t   线程缓存与中心池每次交换的对象批的字节数，默认为4096；对象批中的对象
+ *                              个数在4与32之间。只能由STY_CONF设置
+ *     small_max       size_t   由尺寸类别表服务的最大请求字节数，只读
+ *     numa_nodes      int      按NUMA节点划分的堆的个数，只读
+ * 进程启动后第一次使用分配器时，还会读取一次环境变量STY_CONF，它由逗号分隔的"名字:值"组成，例如
+ *     STY_CONF=tcache_max:256,decay_ms:1000,hugepages:on
+ * 值可以带k、m或g后缀表示乘以2的10、20或30次方；on、yes、true与thp表示1，off、no与false表示0。
+ * 对于hugepages，2m与1g分别表示STY_HUGEPAGE_2M与STY_HUGEPAGE_1G。无法识别的项打印到标准错误并被忽略。
+ *
+ * @note            tcache_max只影响此后的分配与释放；以STY_PERCPU编译时，每CPU缓存的容量在启动时
+ *                  按当时的tcache_max确定，此后不再改变。
+ * @author          bjut-zky
+ * @brief           此函数读取或修改分配器的运行时参数。
+ * @param name      参数的名字。
+ * @param oldp      用来接收修改之前的值，可以为NULL。
+ * @param oldlenp   *oldlenp必须等于参数类型的大小；oldp为NULL时可以为NULL。
+ * @param newp      新的值，NULL表示只读取。
+ * @param newlen    newp不为NULL时必须等于参数类型的大小。
+ * @return int      0表示成功；名字不存在、大小不符、参数只读或新的值无效时返回-1，此时参数不变。
+ */
+STY_API int STY_CDCEL STY_IMPORT
+sty_mallctl(const char *name, void *oldp, size_t *oldlenp, const void *newp, size_t newlen);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
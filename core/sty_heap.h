@@ -0,0 +1,60 @@
+
+#ifndef __STY__HEAP__H__
+#define __STY__HEAP__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+typedef struct sty_heap sty_heap_t;
+
+/**
+ * sty_alloc的所有线程共享同一组按NUMA节点划分的堆，不同用途的对象交错地分布在相同的span与页中，
+ * 释放一大批对象也只能逐个调用sty_free。sty_heap_t是一个独立的堆：它有自己的中心池、页源与大对象
+ * 页堆，从中分配的对象不会与其他堆的对象共用一页内存；sty_heap_destroy把堆向操作系统预留的内存整
+ * 块解除映射，无论其中还有多少存活的对象，开销只与堆占用的内存块个数有关。
+ * 适合按分片、租户或会话隔离内存的场景：每个分片一个堆，丢弃分片时销毁它的堆即可。
+ *
+ * @note            同一个堆的sty_heap_alloc必须由调用者串行化，例如固定由一个线程调用，或者只在持有
+ *                  分片的锁时调用；从堆中分配的对象可以在任何线程中释放。
+ * @note            sty_heap_create获得的堆务必由sty_heap_destroy销毁。
+ * @see             sty_heap_destroy
+ * @brief           此函数创建一个独立的堆。
+ * @author          bjut-zky
+ * @return sty_heap_t* 新创建的堆。此函数不会返回NULL。
+ */
+STY_API sty_heap_t * STY_CDCEL STY_IMPORT
+sty_heap_create(void);
+
+/**
+ * 此函数从heap中分配一段连续的内存，与sty_alloc一样按16字节对齐，得到的内存由sty_free、
+ * sty_free_sized或sty_realloc处理；sty_realloc需要搬移对象时，新的对象仍然从heap中分配。
+ *
+ * @note            从堆中分配的对象不参与sty_heap_profile_rate的采样。
+ * @author          bjut-zky
+ * @brief           此函数从指定的堆中分配一块至少能容纳bytes个字节的内存。
+ * @see             sty_alloc
+ * @param heap      由sty_heap_create得到的堆。
+ * @param bytes     指定大小的字节数。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_heap_alloc(sty_heap_t *heap, size_t bytes);
+
+/**
+ * 此函数销毁一个堆，并把它向操作系统预留的全部内存一次解除映射；尚未释放的对象随之失效，不需要
+ * 也不能再释放它们。
+ *
+ * @note            调用者必须保证此后没有线程再访问heap或其中的对象。
+ * @author          bjut-zky
+ * @brief           此函数销毁一个堆。
+ * @see             sty_heap_create
+ * @param heap      由sty_heap_create得到的堆，或者NULL。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_heap_destroy(sty_heap_t *heap);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
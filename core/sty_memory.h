@@ -9,6 +9,20 @@ extern "C" {
 #define STY_ALLOC_FAILED_RETRY      5
 #define STY_ALLOC_OOM               -1
 
+#define STY_HUGEPAGE_OFF            0
+#define STY_HUGEPAGE_THP            1
+#define STY_HUGEPAGE_2M             2
+#define STY_HUGEPAGE_1G             3
+
+/**
+ * 内存耗尽处理函数。分配失败时，sty先把自己缓存的空闲内存还给操作系统，再调用处理函数；处理函数
+ * 可以释放程序自己的缓存，返回非0表示请求再试一次，返回0表示放弃。
+ * 
+ * @param bytes     失败的请求的字节数。
+ * @param attempt   此前已经重试的次数，从0开始。
+ */
+typedef int (*sty_oom_handler_t)(size_t bytes, int attempt);
+
 /**
  * C99规定的malloc函数用来分配堆内存。实际使用中，这个函数存在一些问题，比如：
  * 1. malloc往往会额外分配一些字节来保存堆空间大小。虽然在x86_64操作系统中内存碎片不是问题，
@@ -17,8 +31,9 @@ extern "C" {
  *    需要针对此情况给出额外的逻辑判断。
  * sty_alloc正是为此而设计；事实上，其内部维护了一个内存池，为减少内存浪费尽了最大努力；令一
  * 方面，sty_alloc保证不会返回空指针。就是说，它要么返回一段足够大且可用的连续内存空间，要么
- * 在多次尝试却失败后调用exit(STY_ALLOC_OOM)函数杀死当前进程，尝试的次数可以通过修改预定义
- * 宏STY_ALLOC_FAILED_RETRY来调试。
+ * 在多次尝试却失败后调用exit(STY_ALLOC_OOM)函数杀死当前进程。是否重试由sty_set_oom_handler
+ * 注册的处理函数决定；没有注册时最多重试STY_ALLOC_FAILED_RETRY次(可以由sty_mallctl的oom_retry
+ * 修改)，两次重试之间的等待时间逐次倍增且有上限。
  * 
  * @note            sty_alloc是线程安全的，但并不是可重入的。
  * @note            sty_alloc获得的内存务必由sty_free释放。
@@ -29,7 +44,152 @@ extern "C" {
  * @return void*    连续内存空间的起始地址，其大小至少可以容纳bytes个字节。此函数不会返回NULL。
  */
 STY_API void * STY_CDCEL STY_IMPORT
-sty_alloc(int bytes);
+sty_alloc(size_t bytes);
+
+/**
+ * 此函数与sty_alloc相同，但在内存耗尽、处理函数放弃重试之后返回NULL而不是结束进程，适用于
+ * 能够降级处理的调用者。
+ * 
+ * @note            sty_try_alloc获得的内存务必由sty_free释放。
+ * @see             sty_alloc
+ * @see             sty_set_oom_handler
+ * @brief           此函数分配一块堆内存，失败时返回NULL。
+ * @author          bjut-zky
+ * @param bytes     指定大小的字节数。
+ * @return void*    连续内存空间的起始地址；内存耗尽时返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_try_alloc(size_t bytes);
+
+/**
+ * 此函数注册内存耗尽处理函数，它对所有线程生效。处理函数在分配失败的线程中被调用，其中仍然可以
+ * 调用sty_free释放内存。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数设置内存耗尽时的处理函数。
+ * @see             sty_oom_handler_t
+ * @param handler   新的处理函数，NULL表示恢复默认的有限次重试。
+ * @return sty_oom_handler_t 此前的处理函数。
+ */
+STY_API sty_oom_handler_t STY_CDCEL STY_IMPORT
+sty_set_oom_handler(sty_oom_handler_t handler);
+
+/**
+ * 此函数分配一段足以容纳count个、每个bytes字节的元素的堆内存，并保证其内容全部为零。和libc
+ * 的calloc不同，对于直接来自操作系统的新映射页，sty_calloc知道其内容已经为零而不会再次清零。
+ * 若count * bytes溢出，和内存耗尽一样调用exit(STY_ALLOC_OOM)。
+ * 
+ * @note            sty_calloc获得的内存务必由sty_free释放。
+ * @see             sty_alloc
+ * @brief           此函数分配一块内容全部为零的堆内存。
+ * @author          bjut-zky
+ * @param count     元素的个数。
+ * @param bytes     每个元素的字节数。
+ * @return void*    连续内存空间的起始地址，其内容全部为零。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_calloc(size_t count, size_t bytes);
+
+/**
+ * 此函数分配一段起始地址按align字节对齐的堆内存，例如64字节对齐的缓存行数据，或4 KiB对齐的
+ * O_DIRECT缓冲区。每个尺寸类别中的对象天然按其大小的最大2的幂因子对齐，sty_alloc_aligned会
+ * 优先选用已经满足对齐要求的类别，而不是多分配一段再填充。
+ * 
+ * @note            align应为2的幂，否则被向上取整为2的幂。超过一页的对齐要求由页堆直接切出按align
+ *                  对齐的run，不受大小限制。
+ * @note            sty_alloc_aligned获得的内存务必由sty_free释放。
+ * @see             sty_alloc
+ * @brief           此函数分配一块满足指定对齐要求的堆内存。
+ * @author          bjut-zky
+ * @param align     对齐的字节数。
+ * @param bytes     指定大小的字节数。
+ * @return void*    按align对齐的连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_alloc_aligned(size_t align, size_t bytes);
+
+/**
+ * 此函数与sty_alloc_aligned相同，但在内存耗尽、处理函数放弃重试之后返回NULL而不是结束进程，
+ * 供对齐的operator new等需要自行处理失败的调用者使用。
+ * 
+ * @note            sty_try_alloc_aligned获得的内存务必由sty_free释放。
+ * @see             sty_alloc_aligned
+ * @see             sty_try_alloc
+ * @brief           此函数分配一块满足指定对齐要求的堆内存，失败时返回NULL。
+ * @author          bjut-zky
+ * @param align     对齐的字节数。
+ * @param bytes     指定大小的字节数。
+ * @return void*    按align对齐的连续内存空间的起始地址；内存耗尽或align无法取整为2的幂时返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_try_alloc_aligned(size_t align, size_t bytes);
+
+/**
+ * sty_alloc为每个NUMA节点维护一个独立的堆，线程在第一次分配时绑定到其所在节点的堆，因此
+ * sty_alloc总是优先返回本节点的内存。此函数则显式地从node节点的堆中分配，适用于由一个线程
+ * 为另一个节点上的线程准备数据的场景。
+ * 
+ * @note            node不是有效的节点编号时，等价于sty_alloc(bytes)。
+ * @note            sty_alloc_onnode获得的内存务必由sty_free释放；释放后内存回到node节点的堆。
+ * @see             sty_alloc
+ * @brief           此函数在指定的NUMA节点上分配一块堆内存。
+ * @author          bjut-zky
+ * @param bytes     指定大小的字节数。
+ * @param node      NUMA节点的编号。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_alloc_onnode(size_t bytes, int node);
+
+/**
+ * 此函数把ptr指向的堆内存调整为至少bytes字节，并保留原有内容中不超过新大小的部分。若新的大小
+ * 仍落在原来的尺寸类别内，则原地返回；大对象缩小时把多余的页还给页堆，扩张时优先吞并紧随其后
+ * 的空闲页，超过16 MiB的大块内存则通过mremap直接搬移页表完成，都不会复制数据。只有在不得不更
+ * 换尺寸类别时才会分配、复制并释放。
+ * 
+ * @note            ptr为NULL时等价于sty_alloc(bytes)。调整成功后，ptr不再可用。
+ * @see             sty_alloc
+ * @brief           此函数调整一块堆内存的大小。
+ * @author          bjut-zky
+ * @param ptr       由函数sty_alloc得到的一块堆内存，或者NULL。
+ * @param bytes     新的字节数。
+ * @return void*    调整后的堆内存的起始地址，可能与ptr相同。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_realloc(void *ptr, size_t bytes);
+
+/**
+ * 与sty_alloc相同，但额外通过actual告诉调用者这块内存实际可用的字节数。请求会被向上取整到尺寸
+ * 类别或整页，多出的部分同样属于调用者：字符串构造器、环形缓冲区等可以直接用满它，而不必为了
+ * 多几个字节就调用sty_realloc。这与C++23中的std::allocate_at_least相对应。
+ * 
+ * @note            以STY_DEBUG编译时多出的部分是红区，*actual总是等于bytes。
+ * @note            得到的内存可以由sty_free释放，也可以用bytes与*actual之间的任意值调用
+ *                  sty_free_sized释放。
+ * @see             sty_usable_size
+ * @brief           此函数分配一块至少bytes字节的堆内存，并返回实际可用的字节数。
+ * @author          bjut-zky
+ * @param bytes     至少需要的字节数。
+ * @param actual    用来接收实际可用的字节数，可以为NULL。
+ * @return void*    连续内存空间的起始地址。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_alloc_at_least(size_t bytes, size_t *actual);
+
+/**
+ * 此函数返回ptr指向的堆内存实际可用的字节数，它不小于分配时请求的字节数，调用者可以使用其中的
+ * 每一个字节。
+ * 
+ * @note            ptr必须来自sty_alloc一族或sty_heap_alloc；对象池与区域中的内存不适用。
+ * @note            以STY_DEBUG编译时返回分配时请求的字节数，其后是红区。
+ * @see             sty_alloc_at_least
+ * @brief           此函数查询一块堆内存实际可用的字节数。
+ * @author          bjut-zky
+ * @param ptr       由函数sty_alloc得到的一块堆内存，或者NULL。
+ * @return size_t   可用的字节数；ptr为NULL时返回0。
+ */
+STY_API size_t STY_CDCEL STY_IMPORT
+sty_usable_size(const void *ptr);
 
 /**
  * 此函数释放由sty_alloc分配得到的堆内存。若这块内存中包含了其他指针，则不保证其他指针指向指
@@ -42,6 +202,187 @@ sty_alloc(int bytes);
 STY_API void STY_CDCEL STY_IMPORT 
 sty_free(void *ptr);
 
+/**
+ * 此函数与sty_free相同，但调用者额外给出了这块内存的大小。sty_free需要通过指针找回内存所属的
+ * 尺寸类别，而sty_free_sized可以直接根据bytes算出尺寸类别，把内存放回对应的空闲链表，省去一
+ * 次对内存元数据的访问。这与C++14中带大小的operator delete相对应。
+ * 定义了预定义宏STY_DEBUG时，此函数会检查bytes是否与内存的实际大小相符，不符时打印错误信息
+ * 并调用abort()。
+ * 
+ * @note            bytes必须等于分配这块内存时传给sty_alloc的字节数，否则行为未定义；经过sty_realloc
+ *                  调整的内存，bytes为最后一次传给sty_realloc的字节数。
+ * @author          bjut-zky
+ * @brief           此函数释放一块已知大小的堆内存。
+ * @see             sty_free
+ * @param ptr       由函数sty_alloc得到的一块堆内存。
+ * @param bytes     分配ptr时请求的字节数。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_free_sized(void *ptr, size_t bytes);
+
+/**
+ * 以预定义宏STY_DEBUG编译时，sty是一个带检查的分配器：每个对象之后有红区，释放时检查红区是否被
+ * 改写、指针是否重复释放或者不是由sty分配的；被释放的小对象被毒化，再次分配时检查是否有代码在释放
+ * 之后写入过它；sty_realloc总是搬移对象。发现错误时打印错误信息并调用abort()。
+ * 此函数进一步为sty_alloc一族分配的大对象开启保护页：每个大对象独占一段映射，红区之后紧贴一个不可
+ * 访问的页，越过红区的访问与释放后的访问都会立即触发SIGSEGV，而不必等到释放时才被发现。
+ * 
+ * @note            未以STY_DEBUG编译时，上述检查全部不存在，此函数什么也不做。
+ * @note            保护页只影响此后的分配；每个大对象至少多占一页地址空间，并且各用一次mmap。
+ * @author          bjut-zky
+ * @brief           此函数开启或关闭调试模式下大对象的保护页。
+ * @param enable    非0表示开启，0表示关闭，负数只查询当前设置。
+ * @return int      此前的设置；未以STY_DEBUG编译时返回-1。
+ */
+STY_API int STY_CDCEL STY_IMPORT 
+sty_debug_guard(int enable);
+
+/**
+ * 此函数一次分配count块大小为bytes字节的堆内存，依次写入out[0]到out[count - 1]。与循环调用
+ * sty_alloc相比，它整段取走线程缓存中的空闲对象，不足的部分在一次加锁中直接从中心池取得，适合
+ * 成组处理报文或消息的场景。
+ * 
+ * @note            和sty_alloc一样，此函数不会失败；每一块内存都要由sty_free或sty_free_bulk
+ *                  释放。
+ * @see             sty_free_bulk
+ * @brief           此函数批量分配大小相同的堆内存。
+ * @author          bjut-zky
+ * @param bytes     每一块内存的字节数。
+ * @param count     内存块的个数。
+ * @param out       用来接收count个起始地址的数组。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_alloc_bulk(size_t bytes, size_t count, void **out);
+
+/**
+ * 此函数释放ptrs中的count块堆内存，它们的大小可以各不相同，其中的NULL被忽略。属于当前线程的
+ * 小块内存先全部链入线程缓存，超出容量的部分最后一次性还给中心池。
+ * 
+ * @see             sty_alloc_bulk
+ * @brief           此函数批量释放堆内存。
+ * @author          bjut-zky
+ * @param ptrs      由sty_alloc等函数得到的堆内存的数组。
+ * @param count     数组的长度。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_free_bulk(void **ptrs, size_t count);
+
+/**
+ * sty_alloc的页源以2 MiB为单位向操作系统预留内存，再从中切出各个尺寸类别的slab。此函数设置这
+ * 些预留内存由什么样的页来支撑：
+ * 1. STY_HUGEPAGE_OFF: 普通的4 KiB页，这是默认值，可以通过预定义宏STY_HUGEPAGE_DEFAULT修改。
+ * 2. STY_HUGEPAGE_THP: 通过madvise(MADV_HUGEPAGE)请求透明大页，不小于2 MiB的大块内存同样如此。
+ * 3. STY_HUGEPAGE_2M: 通过MAP_HUGETLB使用hugetlbfs预留的2 MiB大页。
+ * 4. STY_HUGEPAGE_1G: 通过MAP_HUGETLB使用hugetlbfs预留的1 GiB大页，每次预留1 GiB。
+ * 系统没有预留足够的hugetlbfs大页时，页源透明地退回到STY_HUGEPAGE_THP，而不会导致分配失败。
+ * 
+ * @note            新的策略只影响此后预留的内存。
+ * @author          bjut-zky
+ * @brief           此函数设置页源的大页策略。
+ * @param policy    STY_HUGEPAGE_OFF、STY_HUGEPAGE_THP、STY_HUGEPAGE_2M或STY_HUGEPAGE_1G，
+ *                  其他值只查询当前策略。
+ * @return int      此前的策略。
+ */
+STY_API int STY_CDCEL STY_IMPORT 
+sty_hugepage_policy(int policy);
+
+/**
+ * 被释放的内存不会立即还给操作系统，而是先缓存在页源中以便复用。缓存超过衰减时间仍未被复用的
+ * 内存通过madvise(MADV_DONTNEED)归还物理页(以预定义宏STY_PURGE_LAZY编译时使用MADV_FREE)，
+ * 这样进程的常驻内存在流量高峰过后会逐渐回落。衰减检查摊薄在分配器的慢路径中进行；进程可能长
+ * 时间空闲时，可以再用sty_decay_thread开启一个后台线程。
+ * 
+ * @note            默认的衰减时间为10秒，可以通过预定义宏STY_DECAY_MS_DEFAULT修改。
+ * @see             sty_decay_thread
+ * @brief           此函数设置空闲内存归还操作系统之前的衰减时间。
+ * @author          bjut-zky
+ * @param ms        衰减时间的毫秒数。0表示立即归还，负数表示只在超出sty_rss_limit或调用
+ *                  sty_purge时归还。
+ * @return long     此前的衰减时间。
+ */
+STY_API long STY_CDCEL STY_IMPORT 
+sty_decay_time(long ms);
+
+/**
+ * 此函数为分配器估计的常驻内存(交给调用者的内存与尚未归还的缓存之和)设置上限。一旦超出，分配
+ * 器不再等待衰减时间，立即把全部缓存的物理页归还操作系统。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数设置常驻内存的硬上限。
+ * @param bytes     上限的字节数，0表示不限制。
+ * @return size_t   此前的上限。
+ */
+STY_API size_t STY_CDCEL STY_IMPORT 
+sty_rss_limit(size_t bytes);
+
+/**
+ * 此函数立即把页源中缓存的全部空闲内存的物理页归还操作系统，而不等待衰减时间。
+ * 
+ * @note            以STY_PERCPU编译时，此函数先依次在允许当前线程运行的每个CPU上清空该CPU的缓存，
+ *                  期间会临时修改当前线程的CPU亲和性。
+ * @author          bjut-zky
+ * @brief           此函数立即归还所有空闲的物理页。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_purge(void);
+
+/**
+ * 此函数开启或关闭一个后台线程，它每隔四分之一个衰减时间(最长1秒)检查一次所有的缓存，使空闲
+ * 的进程同样能够按时归还内存。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数开启或关闭负责衰减的后台线程。
+ * @see             sty_decay_time
+ * @param enable    非0表示开启，0表示关闭。
+ * @return int      0表示成功，-1表示无法创建线程。
+ */
+STY_API int STY_CDCEL STY_IMPORT 
+sty_decay_thread(int enable);
+
+/**
+ * 分配器在fork前后自动取得并释放它的全部锁，子进程中其他线程缓存的对象会被还给中心池，不需要
+ * 调用者做任何处理。预热好的主进程反复fork工作进程时，页源中已经归还物理页的空闲内存仍要由fork
+ * 逐段复制映射；开启此选项后，此后被清除的span与大对象run同时以madvise(MADV_DONTFORK)标记，子进程
+ * 不再继承它们，而是在fork返回之前为其中仍然空闲的部分重新映射零页。再次交给调用者之前，这些内存会
+ * 恢复为MADV_DOFORK。
+ * 
+ * @note            子进程不继承分配轨迹的记录，也不继承sty_decay_thread开启的后台线程。
+ * @note            每段被标记的内存都会拆分出单独的映射，大量零散的空闲内存可能逼近
+ *                  vm.max_map_count的限制。
+ * @author          bjut-zky
+ * @brief           此函数设置被清除的空闲内存是否不再被fork出的子进程继承。
+ * @param enable    非0表示开启，0表示关闭。默认关闭。
+ * @return int      此前的设置。
+ */
+STY_API int STY_CDCEL STY_IMPORT 
+sty_purge_dontfork(int enable);
+
+/**
+ * 每个线程都在自己的缓存中保留一部分空闲对象。线程退出时，缓存中的对象会经由线程私有数据的析构
+ * 函数自动还给中心池，不需要调用此函数；此函数供长期存活但暂时不再分配的线程使用，例如线程池中
+ * 即将进入等待的工作线程，使它缓存的对象能被其他线程复用。
+ * 
+ * @note            缓存在下一次分配时重新填充，此函数不影响之后的分配与释放。
+ * @note            以STY_PERCPU编译时，空闲对象缓存在CPU而不是线程中，线程自己只保留批量接口
+ *                  sty_alloc_bulk/sty_free_bulk周转的对象。
+ * @see             sty_thread_idle
+ * @author          bjut-zky
+ * @brief           此函数把当前线程缓存的空闲对象全部还给中心池。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_thread_flush(void);
+
+/**
+ * 此函数在sty_thread_flush的基础上，再收回当前线程所在堆中远程释放的对象，把完全空闲的slab还给
+ * 页源，并按衰减时间检查一次页源的缓存。适合在工作线程即将长时间空闲时调用。
+ * 
+ * @see             sty_thread_flush
+ * @author          bjut-zky
+ * @brief           此函数在当前线程进入空闲之前归还它占用的缓存。
+ */
+STY_API void STY_CDCEL STY_IMPORT 
+sty_thread_idle(void);
+
 #ifdef  __cplusplus
 }
 #endif
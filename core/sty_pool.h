@@ -0,0 +1,127 @@
+
+#ifndef __STY__POOL__H__
+#define __STY__POOL__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* 为每个线程缓存一部分空闲对象，常见的分配与释放不再加锁 */
+#define STY_POOL_THREAD_CACHE       0x1
+
+typedef struct sty_pool sty_pool_t;
+
+/**
+ * 连接、定时器一类的对象大小固定，而且创建与销毁极其频繁。sty_pool_t为这类对象而设计：它只
+ * 管理一种大小的对象，分配和释放都是对侵入式空闲链表的一次O(1)操作，省去了尺寸类别的查找；
+ * 同一个对象池的对象紧凑地排列在一起，局部性也好于通用堆。
+ * 以STY_POOL_THREAD_CACHE创建的对象池会在每个线程中缓存一批空闲对象，此时常见的分配与释放
+ * 只操作本线程的缓存，只有缓存为空或过长时才以批为单位访问对象池。
+ * 
+ * @note            sty_pool_t是线程安全的。对象的起始地址按16字节对齐。
+ * @note            sty_pool_create获得的对象池务必由sty_pool_destroy销毁。
+ * @see             sty_pool_destroy
+ * @brief           此函数创建一个固定大小对象的对象池。
+ * @author          bjut-zky
+ * @param bytes     每个对象的字节数。
+ * @param flags     0或STY_POOL_THREAD_CACHE。
+ * @return sty_pool_t* 新创建的对象池。此函数不会返回NULL。
+ */
+STY_API sty_pool_t * STY_CDCEL STY_IMPORT
+sty_pool_create(size_t bytes, int flags);
+
+/**
+ * 此函数从对象池中取出一个对象。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数从对象池中分配一个对象。
+ * @see             sty_pool_free
+ * @param pool      由sty_pool_create得到的对象池。
+ * @return void*    对象的起始地址，其大小为创建对象池时指定的字节数。此函数不会返回NULL。
+ */
+STY_API void * STY_CDCEL STY_IMPORT
+sty_pool_alloc(sty_pool_t *pool);
+
+/**
+ * 此函数把一个对象还给对象池。
+ * 
+ * @note            obj必须由同一个对象池的sty_pool_alloc得到，不能交给sty_free释放。
+ * @author          bjut-zky
+ * @brief           此函数把一个对象还给对象池。
+ * @see             sty_pool_alloc
+ * @param pool      由sty_pool_create得到的对象池。
+ * @param obj       由sty_pool_alloc得到的对象，或者NULL。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_pool_free(sty_pool_t *pool, void *obj);
+
+/**
+ * 此函数销毁一个对象池，并把它取得的全部内存还给页源；尚未归还的对象也随之失效。
+ * 
+ * @author          bjut-zky
+ * @brief           此函数销毁一个对象池。
+ * @see             sty_pool_create
+ * @param pool      由sty_pool_create得到的对象池。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_pool_destroy(sty_pool_t *pool);
+
+#ifdef  __cplusplus
+}
+
+#include <new>
+#include <utility>
+
+namespace sty {
+
+/**
+ * sty_pool_t的类型化封装：对象在池中的内存上原地构造，destroy时先析构再归还内存。
+ * 析构object_pool时，尚未destroy的对象不会被析构。
+ * 
+ * @author          bjut-zky
+ * @brief           T类型对象的对象池。
+ */
+template <typename T>
+class object_pool {
+public:
+    static_assert(alignof(T) <= 16, "sty::object_pool only guarantees 16-byte alignment");
+
+    explicit object_pool(int flags = 0)
+        : pool_(sty_pool_create(sizeof(T), flags)) {}
+
+    ~object_pool() {
+        sty_pool_destroy(pool_);
+    }
+
+    object_pool(const object_pool &) = delete;
+    object_pool &operator=(const object_pool &) = delete;
+
+    template <typename... Args>
+    T *create(Args &&...args) {
+        void *mem = sty_pool_alloc(pool_);
+        try {
+            return ::new (mem) T(std::forward<Args>(args)...);
+        } catch (...) {
+            sty_pool_free(pool_, mem);
+            throw;
+        }
+    }
+
+    void destroy(T *obj) {
+        if (obj != nullptr) {
+            obj->~T();
+            sty_pool_free(pool_, obj);
+        }
+    }
+
+    sty_pool_t *native_handle() const {
+        return pool_;
+    }
+
+private:
+    sty_pool_t *pool_;
+};
+
+}
+#endif
+#endif
@@ -0,0 +1,46 @@
+
+#ifndef __STY__PROFILE__H__
+#define __STY__PROFILE__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * sty内置一个按泊松过程采样的堆分析器：平均每分配rate字节采样一次，被采样的对象记录下分配时的
+ * 调用栈，直到被释放为止。按字节而不是按次数采样，大对象被采到的概率与其大小成正比，因此
+ * 512 KiB左右的采样间隔对吞吐几乎没有影响，可以常开在线上进程中寻找内存泄漏与热点。
+ * 调用栈通过帧指针回溯获得，sty与被分析的程序都应以-fno-omit-frame-pointer编译；以预定义宏
+ * STY_PROFILE_LIBUNWIND编译时改用libunwind，此时需要链接-lunwind。
+ *
+ * @note            sty_alloc_bulk、sty_alloc_onnode、区域与对象池的分配不参与采样。
+ * @note            停止采样后，已经采到且仍未释放的对象依然出现在sty_heap_profile_dump的输出中。
+ * @see             sty_heap_profile_dump
+ * @brief           此函数设置堆分析器的平均采样间隔。
+ * @author          bjut-zky
+ * @param bytes     平均采样间隔的字节数，0表示停止采样，默认为0。
+ * @return size_t   此前的采样间隔。
+ */
+STY_API size_t STY_CDCEL STY_IMPORT
+sty_heap_profile_rate(size_t bytes);
+
+/**
+ * 此函数把所有仍未释放的被采样对象以pprof兼容的legacy堆分析格式(heap_v2)写入文件描述符fd，
+ * 之后附上/proc/self/maps以便符号化，例如：
+ *     pprof --text ./your_program heap.prof
+ * pprof会根据采样间隔把样本换算回整个堆的估计值。此函数不分配任何堆内存，可以在信号处理函数之
+ * 外的任何地方调用，包括内存即将耗尽时。
+ *
+ * @author          bjut-zky
+ * @brief           此函数以pprof格式输出当前的堆分析结果。
+ * @see             sty_heap_profile_rate
+ * @param fd        已经以写方式打开的文件描述符。
+ * @return int      0表示成功，-1表示写入失败，errno指出原因。
+ */
+STY_API int STY_CDCEL STY_IMPORT
+sty_heap_profile_dump(int fd);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,56 @@
+
+#ifndef __STY__STATS__H__
+#define __STY__STATS__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#define STY_STATS_CLASSES           20
+
+/**
+ * 一个尺寸类别的统计。allocs与frees在各个线程中分别计数，读取时才汇总，因此在其他线程仍在分配
+ * 时得到的只是一个近似的快照。
+ */
+typedef struct sty_class_stats {
+    size_t              size;           /* 该类别中每个对象的字节数 */
+    size_t              allocs;         /* 累计分配的对象个数 */
+    size_t              frees;          /* 累计释放的对象个数 */
+    size_t              live;           /* 正在使用的对象个数 */
+    size_t              bytes;          /* 正在使用的字节数 */
+    size_t              thread_cached;  /* 缓存在各个线程中的空闲对象个数 */
+    size_t              cpu_cached;     /* 以STY_PERCPU编译时，缓存在各个CPU中的空闲对象个数 */
+    size_t              central_cached; /* 中心池的span中尚未取走的空闲对象个数 */
+    size_t              transfer_cached;    /* 中心池的转移缓存中成批存放的空闲对象个数 */
+    size_t              spans;          /* 该类别占用的span个数 */
+} sty_class_stats;
+
+typedef struct sty_stats {
+    sty_class_stats     classes[STY_STATS_CLASSES];
+    size_t              large_count;    /* 正在使用的大对象个数 */
+    size_t              large_bytes;    /* 大对象占用的字节数，按页取整 */
+    size_t              active_bytes;   /* 交给尺寸类别、区域、对象池的span与大对象的字节数 */
+    size_t              dirty_bytes;    /* 页源缓存的span与页堆的空闲run中尚未归还物理页的字节数 */
+    size_t              mapped_bytes;   /* 向操作系统映射的字节数 */
+    size_t              mmap_calls;     /* 累计调用mmap与mremap的次数 */
+    size_t              munmap_calls;   /* 累计调用munmap的次数 */
+    size_t              threads;        /* 正在使用sty的线程个数 */
+} sty_stats;
+
+/**
+ * 此函数汇总分配器当前的统计信息。分配与释放的计数保存在各个线程自己的线程缓存中，快路径不会
+ * 写任何共享的缓存行；只有调用此函数时才遍历所有线程和中心池，所以它比一次分配慢得多，适合定期
+ * 采样，而不是在每次请求中调用。
+ *
+ * @note            远程释放尚未被中心池收回的对象既不计入live，也不计入central_cached。
+ * @author          bjut-zky
+ * @brief           此函数读取分配器的统计信息。
+ * @param stats     用来接收统计信息的结构体。
+ */
+STY_API void STY_CDCEL STY_IMPORT
+sty_stats_get(sty_stats *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
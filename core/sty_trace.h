@@ -0,0 +1,52 @@
+
+#ifndef __STY__TRACE__H__
+#define __STY__TRACE__H__
+#include "sty_types.h"
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#define STY_TRACE_MAGIC             "STYTRC1\n"
+
+#define STY_TRACE_ALLOC             0       /* 大小, 指针 */
+#define STY_TRACE_FREE              1       /* 指针 */
+#define STY_TRACE_REALLOC           2       /* 原指针, 大小, 新指针 */
+#define STY_TRACE_ALIGNED           3       /* 对齐, 大小, 指针 */
+#define STY_TRACE_CALLOC            4       /* 大小, 指针 */
+
+/**
+ * 此函数开始把此后每一次分配与释放记录到文件描述符fd中，用于离线重放真实的分配序列，见
+ * bench/replay.c。每个线程先把记录写入自己的缓冲区，缓冲区满时才整块写入fd，所以记录的开销只是
+ * 一次读时钟和几个字节的编码。
+ * 文件以8字节的STY_TRACE_MAGIC开头，之后是若干个数据块，每个数据块由三个变长整数
+ *     线程编号, 首条记录距开始记录的纳秒数, 记录部分的字节数
+ * 以及随后的记录组成。变长整数每字节保存7位，低位在前，最高位为1表示后面还有字节。每条记录以
+ * 一个字节的类型STY_TRACE_*开头，接着是距上一条记录(每块的第一条记录为距本块的首条记录)的纳
+ * 秒数，然后是上面各个类型后注明的字段，均为变长整数。指针以其地址右移4位后的值表示，同一个值
+ * 在释放之后可能再次出现。
+ *
+ * @note            同一时刻只能有一个记录在进行。fd在sty_trace_stop返回之前必须保持打开。
+ * @see             sty_trace_stop
+ * @brief           此函数开始记录分配轨迹。
+ * @author          bjut-zky
+ * @param fd        已经以写方式打开的文件描述符。
+ * @return int      0表示成功，-1表示已经在记录或者写入失败。
+ */
+STY_API int STY_CDCEL STY_IMPORT
+sty_trace_start(int fd);
+
+/**
+ * 此函数停止记录，并把所有线程缓冲区中剩余的记录写入fd。此函数不关闭fd。
+ *
+ * @author          bjut-zky
+ * @brief           此函数停止记录分配轨迹。
+ * @see             sty_trace_start
+ * @return int      0表示所有记录都已写入，-1表示记录期间发生过写入失败或者没有在记录。
+ */
+STY_API int STY_CDCEL STY_IMPORT
+sty_trace_stop(void);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
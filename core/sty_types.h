@@ -4,7 +4,32 @@
 #include <inttypes.h>
 #include <stddef.h>
 
-#define STY_API     extern "C" 
+/**
+ * STY_VISIBLE使公开的接口在动态库中可见。编译sty自身时定义STY_BUILD，在Windows上导出接口；以动态库方式
+ * 使用sty时定义STY_SHARED，在Windows上导入接口；其他平台以-fvisibility=hidden编译，只有标记了
+ * STY_VISIBLE的接口留在动态符号表中，其余函数可以在链接期优化中内联或删除。
+ * 属性放在声明的开头，写在返回类型的*之后时GCC会忽略它，所以并入STY_API，STY_EXPORT与STY_IMPORT
+ * 分别只用来标明定义与声明。
+ */
+#if defined(_WIN32) || defined(__CYGWIN__)
+#if defined(STY_BUILD)
+#define STY_VISIBLE __declspec(dllexport)
+#elif defined(STY_SHARED)
+#define STY_VISIBLE __declspec(dllimport)
+#else
+#define STY_VISIBLE
+#endif
+#elif defined(__GNUC__) && __GNUC__ >= 4
+#define STY_VISIBLE __attribute__((visibility("default")))
+#else
+#define STY_VISIBLE
+#endif
+
+#ifdef  __cplusplus
+#define STY_API     extern "C" STY_VISIBLE
+#else
+#define STY_API     extern STY_VISIBLE
+#endif
 #define STY_EXPORT  
 #define STY_IMPORT
 #define STY_CDCEL   
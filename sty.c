@@ -0,0 +1,4428 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "sty.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#ifdef STY_PROFILE_LIBUNWIND
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#endif
+#if defined(STY_PERCPU) && defined(__linux__) && defined(__x86_64__) && defined(__GNUC__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#include <stddef.h>
+#define STY_RSEQ            1
+#endif
+#endif
+#ifndef STY_RSEQ
+#define STY_RSEQ            0               /* 每CPU缓存只支持x86-64 Linux与glibc 2.35以上 */
+#endif
+
+/**
+ * sty_alloc的内部实现。
+ * 不大于STY_SMALL_MAX字节的请求被向上取整到一张固定的尺寸类别表中，每个类别拥有自己的slab(下
+ * 文称为span)。span是一段按STY_SPAN_SIZE对齐的连续内存，头部保存该span的元数据，其余空间被
+ * 切分成等长的对象；空闲对象的前8个字节用作侵入式链表指针，因此对象本身不携带任何头部。
+ * 由于span按其大小对齐，任何指针只需屏蔽掉低位便能找到所属span的元数据。
+ * 更大的请求从每个堆的页堆中切出一段按页取整的连续内存(下文称为run)，run的描述符不放在run内部，
+ * 而是由页映射表从地址查到；释放时先查页映射表，没有登记的指针才属于span。
+ * span中第一个对象的偏移按类别大小的最大2的幂因子对齐，所以每个对象都天然地按该因子对齐，
+ * 例如64字节类别的对象总是落在缓存行的边界上。
+ *
+ * 每个线程在中心池之前有一份线程缓存：每个尺寸类别一个LIFO链表。常见的分配与释放只操作本线程
+ * 的链表，不使用任何原子操作或锁；只有链表为空或过长时，才以批为单位与中心池交换对象。
+ * 以STY_PERCPU编译时，快路径改用每个CPU一份的缓存，由restartable sequence(rseq)保证不需要原子
+ * 操作或锁，缓存的空闲对象总量只与CPU个数有关，而与线程个数无关；线程缓存只在rseq不可用时使用。
+ *
+ * 线程缓存溢出的一批对象先原样压入中心池的转移缓存(一个无锁的对象批栈)，缺对象的线程缓存优先
+ * 从那里整批取走，所以大量线程同时缺对象时也不会在中心池的锁上排队。
+ * 其余离开线程缓存的对象(转移缓存已满时溢出的，或者生产者分配、消费者释放的)同样不会去抢中心
+ * 池的锁，而是以无锁的方式压入所属span的远程释放链表(多生产者、单消费者)；第一个让该链表变为
+ * 非空的释放者同时把span登记到中心池的待回收栈中。中心池在下一次取对象时才在锁内把它们收回。
+ *
+ * 中心池与页源按NUMA节点分成若干个堆，线程在第一次分配时绑定到其所在节点的堆，堆的页源用
+ * mbind把内存优先放在本节点上。释放时，不属于本线程所在堆的对象直接经由远程释放链表送回其所
+ * 属的堆，不会被本节点的线程复用。
+ * 此外，sty_heap_create可以创建不绑定到任何线程的独立堆，它的对象同样经由远程释放链表送回，
+ * 销毁时连同全部内存一并归还。
+ */
+#define STY_SPAN_SHIFT      16
+#define STY_SPAN_SIZE       ((size_t)1 << STY_SPAN_SHIFT)
+#define STY_SPAN_MASK       (~(STY_SPAN_SIZE - 1))
+#define STY_SPAN_CACHE_MAX  64
+#define STY_SMALL_MAX       1024
+#define STY_NUM_CLASSES     20
+#define STY_BATCH_BYTES     4096
+#define STY_BATCH_MIN       4
+#define STY_BATCH_MAX       32
+#define STY_NUMA_MAX        64
+#define STY_MPOL_PREFERRED  1
+#define STY_HUGE_2M         ((size_t)2 << 20)
+#define STY_HUGE_1G         ((size_t)1 << 30)
+#define STY_OOM_BACKOFF_MAX 64              /* 内存耗尽时两次重试之间最长等待的毫秒数 */
+#define STY_TRANSFER_SLOTS  32              /* 每个中心池的转移缓存最多存放的对象批数 */
+#if !defined(STY_NO_TRANSFER) && ATOMIC_LLONG_LOCK_FREE == 2
+#define STY_TRANSFER        1
+#else
+#define STY_TRANSFER        0               /* 没有无锁的64位CAS时，线程缓存只经由加锁的中心池周转 */
+#endif
+#define STY_PAGE_SHIFT      12              /* 页映射表的粒度，不大于实际的页大小 */
+#define STY_PAGEMAP_BITS    36              /* 48位地址空间中的页号位数 */
+#define STY_PAGEMAP_LEAF    18              /* 每个叶节点覆盖的页号位数 */
+#define STY_LARGE_DIRECT    ((size_t)16 << 20)  /* 超过此大小的对象独占一段映射，这是sty_direct_min的默认值 */
+#define STY_RUN_EXACT       64              /* 不超过这么多页的空闲run按页数精确分档 */
+#define STY_RUN_BINS        192
+#ifndef STY_DECAY_MS_DEFAULT
+#define STY_DECAY_MS_DEFAULT 10000
+#endif
+#if defined(STY_PURGE_LAZY) && defined(MADV_FREE)
+#define STY_MADV_PURGE      MADV_FREE
+#else
+#define STY_MADV_PURGE      MADV_DONTNEED
+#endif
+#ifndef STY_HUGEPAGE_DEFAULT
+#define STY_HUGEPAGE_DEFAULT STY_HUGEPAGE_OFF
+#endif
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_2MB)
+#define MAP_HUGE_2MB        (21 << MAP_HUGE_SHIFT)
+#define MAP_HUGE_1GB        (30 << MAP_HUGE_SHIFT)
+#endif
+#if defined(__GNUC__)
+/* 以LD_PRELOAD方式替换malloc时，动态TLS模型的首次访问本身可能调用malloc */
+#define STY_TLS             __thread __attribute__((tls_model("initial-exec")))
+#else
+#define STY_TLS             __thread
+#endif
+
+typedef struct sty_span {
+    struct sty_span    *next;
+    struct sty_span    *prev;
+    void               *free;           /* span内空闲对象组成的链表 */
+    char               *bump;           /* 尚未切分过的区域的起点 */
+    char               *limit;          /* 可切分区域的终点 */
+    uint32_t            used;           /* 已经分配出去的对象个数 */
+    uint32_t            capacity;       /* span最多能容纳的对象个数 */
+    uint16_t            cls;            /* 尺寸类别 */
+    uint16_t            nofork;         /* 首页之外的部分带有MADV_DONTFORK，只在clean链表中为1 */
+    _Atomic(void *)     remote;         /* 其他线程归还、尚未收回的对象 */
+    struct sty_span    *pending;        /* 待回收栈中的下一个span */
+    struct sty_heap    *heap;           /* span所属的堆 */
+    uint64_t            stamp;          /* span被还给页源的时刻(毫秒) */
+} sty_span;
+
+#define STY_SPAN_HEADER     ((sizeof(sty_span) + 63) & ~(size_t)63)
+
+/* run的状态；空闲的run按其是否仍占有物理页分为dirty与clean */
+#define STY_RUN_USED        0
+#define STY_RUN_DIRTY       1
+#define STY_RUN_CLEAN       2
+#define STY_RUN_BUSY        3               /* 暂时摘出空闲链表，正在清除物理页或解除映射 */
+#define STY_RUN_DIRECT      4               /* 独占一段映射的大对象 */
+#define STY_RUN_GUARD       5               /* 以STY_DEBUG编译时，独占一段映射并紧贴保护页的大对象 */
+
+typedef struct sty_run {
+    struct sty_run     *next;           /* 空闲链表或采样链表中的下一项 */
+    struct sty_run     *prev;
+    char               *base;
+    size_t              bytes;          /* 按页取整的字节数 */
+    struct sty_heap    *heap;           /* 描述符所属的堆，切分描述符时写入，此后不变 */
+    uint64_t            stamp;          /* 成为dirty的时刻(毫秒) */
+    struct sty_sample  *sample;         /* 被采样的对象的采样记录，否则为NULL */
+    int                 state;
+    int                 nofork;         /* clean的run中可能有带MADV_DONTFORK的部分 */
+} sty_run;
+
+typedef _Atomic(sty_run *) sty_page_entry;
+
+/* 转移缓存中的一个对象批，描述符内嵌在中心池中，从不释放 */
+typedef struct sty_batch {
+    _Atomic(uint32_t)   next;           /* 栈中下一个描述符的下标加一，0表示栈底 */
+    void               *head;           /* 恰好sty_class_batch[cls]个对象组成的链表 */
+} sty_batch;
+
+/**
+ * 转移缓存位于线程缓存与span之间：线程缓存溢出时把一整批对象原样压入，另一个线程缓存为空时整
+ * 批取走，中间既不拆开对象批也不加锁。描述符在full与empty两个Treiber栈之间移动，栈顶是一个64位
+ * 的字，高32位是每次修改都加一的标签，低32位是描述符的下标加一；出栈时即使读到的next已经过时，
+ * 标签也会使CAS失败，所以不存在ABA问题。描述符内嵌在中心池中，读取过时的next也总是安全的。
+ */
+typedef struct sty_central {
+    _Alignas(64) pthread_mutex_t lock;
+    sty_span           *partial;        /* 尚有空闲对象的span */
+    _Atomic(sty_span *) pending;        /* 远程释放链表非空的span */
+    size_t              spans;          /* 属于该类别的span个数 */
+    size_t              used;           /* 这些span中已被取走的对象个数，包括转移缓存中的对象 */
+#if STY_TRANSFER
+    _Alignas(64) _Atomic(uint64_t) full;    /* 装有对象批的描述符 */
+    _Atomic(uint64_t)   empty;          /* 空闲的描述符 */
+    _Atomic(uint32_t)   batches;        /* full中的对象批数，只用于统计 */
+    sty_batch           slots[STY_TRANSFER_SLOTS];
+#endif
+} sty_central;
+
+typedef struct sty_bin {
+    void               *head;
+    uint32_t            count;
+    uint64_t            allocs;         /* 本线程分配的对象个数，只由本线程写 */
+    uint64_t            frees;          /* 本线程释放的对象个数，只由本线程写 */
+} sty_bin;
+
+/* 堆向操作系统预留的一段内存 */
+typedef struct sty_region {
+    char               *base;
+    size_t              bytes;
+    int                 large;          /* 属于大对象页堆而不是页源 */
+} sty_region;
+
+/**
+ * 页源：以2 MiB(或1 GiB)为单位向操作系统预留内存，按需从中切出span，并缓存被归还的span，避免
+ * 频繁地mmap/munmap。大页策略允许时，预留的内存优先由hugetlbfs大页或透明大页提供，这样同一
+ * 块预留内存中切出的所有slab共用一个TLB表项。
+ * 被归还的span先进入dirty链表(新的在前)。在dirty链表中停留超过衰减时间的span被madvise清除
+ * 物理页后移入clean链表；span首页保存着链表指针，所以清除时保留首页。
+ */
+typedef struct sty_heap {
+    sty_central         centrals[STY_NUM_CLASSES];
+    _Alignas(64) pthread_mutex_t pages_lock;
+    sty_span           *pages_cache;    /* dirty链表 */
+    size_t              pages_cached;
+    sty_span           *pages_clean;    /* 物理页已经归还操作系统的span */
+    char               *pages_cur;      /* 当前预留内存中尚未切分的部分 */
+    char               *pages_end;
+    uint64_t            decay_next;     /* 下一次检查衰减的时刻 */
+    int                 node;           /* 页源的内存所在的NUMA节点 */
+    _Alignas(64) pthread_mutex_t large_lock;
+    sty_run            *large_free[2][STY_RUN_BINS];    /* dirty与clean的空闲run，按大小分档 */
+    uint64_t            large_bits[2][(STY_RUN_BINS + 63) / 64];   /* 非空的档 */
+    sty_run            *run_spare;      /* 空闲的run描述符 */
+    size_t              large_live;     /* 正在使用的run个数，由large_lock保护 */
+    /**
+     * 以下只属于由sty_heap_create创建的堆。这样的堆从不单独解除映射其中的任何一段内存，
+     * sty_heap_destroy时按regions整块解除映射；regions由pages_lock保护。
+     */
+    _Alignas(64) sty_bin bins[STY_NUM_CLASSES]; /* sty_heap_alloc取对象的缓存 */
+    int                 user;
+    sty_region         *regions;
+    size_t              region_count;
+    size_t              region_cap;
+    struct sty_heap    *next;           /* 堆登记表，由sty_user_lock保护 */
+    struct sty_heap    *prev;
+} sty_heap;
+
+/* 对象池在线程缓存中的一项，按对象池的编号直接映射 */
+#define STY_POOL_TCACHE     8
+
+typedef struct sty_pool_bin {
+    struct sty_pool    *pool;
+    uint64_t            id;             /* 缓存时对象池的编号，0表示空闲 */
+    void               *head;
+    uint32_t            count;
+} sty_pool_bin;
+
+typedef struct sty_tcache {
+    sty_bin             bins[STY_NUM_CLASSES];
+    sty_heap           *heap;           /* 线程绑定的堆，首次分配之前为NULL，析构之后为STY_TCACHE_DEAD */
+    sty_pool_bin        pools[STY_POOL_TCACHE];
+    struct sty_tcache  *next;           /* 线程登记表，由sty_threads_lock保护 */
+    struct sty_tcache  *prev;
+    int64_t             sample_left;    /* 距离下一次采样还需分配的字节数 */
+    uint64_t            sample_seed;
+    struct sty_trace_buf *trace;        /* 记录分配轨迹的缓冲区，首次记录时映射 */
+} sty_tcache;
+
+#define STY_TCACHE_DEAD     ((sty_heap *)(uintptr_t)1)  /* 线程私有数据已经析构 */
+
+/* 16字节步长直到128字节，此后每翻一倍再细分为4档，直到STY_SMALL_MAX */
+static const uint16_t sty_class_size[STY_NUM_CLASSES] = {
+    16,  32,  48,  64,  80,  96,  112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024
+};
+
+/* 类别中每个对象天然满足的对齐要求，即类别大小的最大2的幂因子 */
+#define STY_CLASS_ALIGN(cls)    ((size_t)(sty_class_size[cls] & -sty_class_size[cls]))
+
+/* 以(bytes + 15) >> 4为下标查询尺寸类别 */
+static const uint8_t sty_class_index[(STY_SMALL_MAX >> 4) + 1] = {
+    0,
+    0,  1,  2,  3,  4,  5,  6,  7,
+    8,  8,  9,  9,  10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13,
+    14, 14, 14, 14, 15, 15, 15, 15,
+    16, 16, 16, 16, 16, 16, 16, 16,
+    17, 17, 17, 17, 17, 17, 17, 17,
+    18, 18, 18, 18, 18, 18, 18, 18,
+    19, 19, 19, 19, 19, 19, 19, 19
+};
+
+static sty_heap             sty_heaps[STY_NUMA_MAX];
+static int                  sty_numa_nodes = 1;
+static int                  sty_multi_heap;     /* 存在多个堆时，释放必须检查对象所属的堆 */
+static uint32_t             sty_class_batch[STY_NUM_CLASSES];   /* 与中心池交换的批大小 */
+static uint32_t             sty_class_cache[STY_NUM_CLASSES];   /* 线程缓存链表的上限 */
+static uint32_t             sty_class_offset[STY_NUM_CLASSES];  /* span中第一个对象的偏移 */
+static STY_TLS sty_tcache   sty_tc;
+static pthread_once_t       sty_once = PTHREAD_ONCE_INIT;
+static pthread_key_t        sty_tc_key;         /* 线程退出时注销线程缓存 */
+static pthread_mutex_t      sty_threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static sty_tcache          *sty_threads;
+static uint64_t             sty_retired_allocs[STY_NUM_CLASSES];    /* 已退出线程的计数 */
+static uint64_t             sty_retired_frees[STY_NUM_CLASSES];
+static size_t               sty_page_size;
+
+static _Atomic(int)         sty_hugepage = STY_HUGEPAGE_DEFAULT;
+static _Atomic(long)        sty_decay_ms = STY_DECAY_MS_DEFAULT;
+static _Atomic(size_t)      sty_rss_max;        /* 0表示不限制 */
+static _Atomic(size_t)      sty_active_bytes;   /* 已交给调用者的span与大对象 */
+static _Atomic(size_t)      sty_dirty_bytes;    /* dirty链表中的span */
+static _Atomic(int)         sty_decay_running;
+static _Atomic(int)         sty_dontfork;       /* 清除物理页时同时加上MADV_DONTFORK */
+static _Atomic(int)         sty_oom_retry = STY_ALLOC_FAILED_RETRY;
+static _Atomic(size_t)      sty_span_cache_max = STY_SPAN_CACHE_MAX;
+static _Atomic(size_t)      sty_direct_min = STY_LARGE_DIRECT;
+static size_t               sty_batch_bytes = STY_BATCH_BYTES;  /* 只能由STY_CONF设置 */
+static _Atomic(size_t)      sty_tcache_max;     /* 0表示两个对象批 */
+static _Atomic(sty_oom_handler_t) sty_oom_fn;
+static _Atomic(size_t)      sty_large_count;
+static _Atomic(size_t)      sty_large_bytes;
+static _Atomic(size_t)      sty_mapped_bytes;
+static _Atomic(size_t)      sty_mmap_calls;
+static _Atomic(size_t)      sty_munmap_calls;
+static sty_page_entry      *_Atomic sty_pagemap[(size_t)1 << (STY_PAGEMAP_BITS - STY_PAGEMAP_LEAF)];
+static pthread_mutex_t      sty_pagemap_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t      sty_user_lock = PTHREAD_MUTEX_INITIALIZER;
+static sty_heap            *sty_user_heaps;     /* 由sty_heap_create创建、尚未销毁的堆 */
+
+_Static_assert(STY_STATS_CLASSES == STY_NUM_CLASSES, "sty_stats.h is out of sync with the size classes");
+_Static_assert(STY_CLASS_COUNT == STY_NUM_CLASSES && STY_CLASS_MAX == STY_SMALL_MAX,
+               "sty_class.h is out of sync with the size classes");
+
+/* 读取/sys/devices/system/node/possible这样的编号列表(形如"0-1")，取其中最大的编号加一 */
+static int
+sty_sysfs_count(const char *path, int max) {
+    char buf[64];
+    ssize_t len, i;
+    int fd, id = 0, count = 1;
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return 1;
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    for (i = 0; i < len; ++i) {
+        if (buf[i] >= '0' && buf[i] <= '9') {
+            id = id * 10 + (buf[i] - '0');
+            if (id + 1 > count)
+                count = id + 1;
+        } else {
+            id = 0;
+        }
+    }
+    return count < max ? count : max;
+}
+
+static void
+sty_heap_init(sty_heap *heap, int node) {
+    int i;
+#if STY_TRANSFER
+    int j;
+#endif
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        pthread_mutex_init(&heap->centrals[i].lock, NULL);
+        heap->centrals[i].partial = NULL;
+        atomic_init(&heap->centrals[i].pending, NULL);
+        heap->centrals[i].spans = heap->centrals[i].used = 0;
+#if STY_TRANSFER
+        atomic_init(&heap->centrals[i].full, 0);
+        atomic_init(&heap->centrals[i].batches, 0);
+        for (j = 0; j < STY_TRANSFER_SLOTS; ++j)
+            atomic_init(&heap->centrals[i].slots[j].next, j + 1 < STY_TRANSFER_SLOTS ? (uint32_t)j + 2 : 0);
+        atomic_init(&heap->centrals[i].empty, 1);
+#endif
+    }
+    pthread_mutex_init(&heap->pages_lock, NULL);
+    heap->pages_cache = NULL;
+    heap->pages_cached = 0;
+    heap->pages_clean = NULL;
+    heap->pages_cur = heap->pages_end = NULL;
+    heap->decay_next = 0;
+    heap->node = node;
+    pthread_mutex_init(&heap->large_lock, NULL);
+    memset(heap->large_free, 0, sizeof(heap->large_free));
+    memset(heap->large_bits, 0, sizeof(heap->large_bits));
+    heap->run_spare = NULL;
+    heap->large_live = 0;
+    memset(heap->bins, 0, sizeof(heap->bins));
+    heap->user = 0;
+    heap->regions = NULL;
+    heap->region_count = heap->region_cap = 0;
+    heap->next = heap->prev = NULL;
+}
+
+static void sty_trace_exit(sty_tcache *tc);
+static void sty_tcache_release(sty_tcache *tc);
+
+/* 把tc的计数并入sty_retired_*，调用者必须持有sty_threads_lock */
+static void
+sty_tcache_retire(sty_tcache *tc) {
+    int i;
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        sty_retired_allocs[i] += tc->bins[i].allocs;
+        sty_retired_frees[i] += tc->bins[i].frees;
+        tc->bins[i].allocs = tc->bins[i].frees = 0;
+    }
+}
+
+/* 析构之后的线程不在登记表中，每次经过慢路径时把计数并入sty_retired_* */
+static void
+sty_tcache_dead_retire(void) {
+    pthread_mutex_lock(&sty_threads_lock);
+    sty_tcache_retire(&sty_tc);
+    pthread_mutex_unlock(&sty_threads_lock);
+}
+
+/**
+ * 线程退出时把缓存的对象还给中心池，把计数并入sty_retired_*，并从登记表中摘除。线程私有数据的
+ * 析构函数之后仍可能有分配与释放(例如glibc的__libc_thread_freeres)，所以heap被设为
+ * STY_TCACHE_DEAD而不是NULL：此后线程不再登记，也不再缓存对象，小对象直接从中心池取得，释放时
+ * 送回所属的span。否则同一块线程局部存储会被后来的线程再次插入登记表。
+ */
+static void
+sty_tcache_exit(void *arg) {
+    sty_tcache *tc = (sty_tcache *)arg;
+    sty_tcache_release(tc);
+    pthread_mutex_lock(&sty_threads_lock);
+    sty_tcache_retire(tc);
+    if (tc->prev != NULL)
+        tc->prev->next = tc->next;
+    else
+        sty_threads = tc->next;
+    if (tc->next != NULL)
+        tc->next->prev = tc->prev;
+    tc->heap = STY_TCACHE_DEAD;
+    pthread_mutex_unlock(&sty_threads_lock);
+    sty_trace_exit(tc);
+}
+
+#ifdef STY_DEBUG
+static void sty_fatal(const char *msg);
+#endif
+#if STY_RSEQ
+static void sty_cpu_init(void);
+#endif
+static void sty_fork_prepare(void);
+static void sty_fork_parent(void);
+static void sty_fork_child(void);
+static void sty_conf_init(void);
+static void sty_tcache_tune(void);
+
+static void
+sty_init(void) {
+    int i;
+    long page = sysconf(_SC_PAGESIZE);
+#ifdef STY_DEBUG
+    size_t bytes;
+    /* sty_class.h中的STY_SIZE_CLASS必须与查询表给出相同的类别 */
+    for (bytes = 0; bytes <= STY_SMALL_MAX; ++bytes) {
+        if (STY_SIZE_CLASS(bytes) != sty_class_index[(bytes + 15) >> 4])
+            sty_fatal("sty_class.h: STY_SIZE_CLASS does not match the size class table\n");
+    }
+#endif
+    sty_page_size = page > 0 ? (size_t)page : 4096;
+    sty_numa_nodes = sty_sysfs_count("/sys/devices/system/node/possible", STY_NUMA_MAX);
+    sty_multi_heap = sty_numa_nodes > 1;
+    pthread_key_create(&sty_tc_key, sty_tcache_exit);
+    for (i = 0; i < sty_numa_nodes; ++i)
+        sty_heap_init(&sty_heaps[i], i);
+    sty_conf_init();
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        size_t batch = sty_batch_bytes / sty_class_size[i];
+        if (batch < STY_BATCH_MIN)
+            batch = STY_BATCH_MIN;
+        if (batch > STY_BATCH_MAX)
+            batch = STY_BATCH_MAX;
+        sty_class_batch[i] = (uint32_t)batch;
+        sty_class_offset[i] = (uint32_t)((STY_SPAN_HEADER + STY_CLASS_ALIGN(i) - 1) & ~(STY_CLASS_ALIGN(i) - 1));
+    }
+    sty_tcache_tune();
+#if STY_RSEQ
+    sty_cpu_init();
+#endif
+    pthread_atfork(sty_fork_prepare, sty_fork_parent, sty_fork_child);
+}
+
+/**
+ * 向操作系统申请bytes字节、按align对齐的内存。mmap只保证按页对齐，所以多映射一段再把首尾多余
+ * 的部分归还。
+ */
+static int sty_os_unmap(void *base, size_t bytes);
+
+static void *
+sty_os_map(size_t bytes, size_t align) {
+    size_t total = bytes + align;
+    char *raw, *base;
+    atomic_fetch_add_explicit(&sty_mmap_calls, 1, memory_order_relaxed);
+    raw = (char *)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == (char *)MAP_FAILED)
+        return NULL;
+    atomic_fetch_add_explicit(&sty_mapped_bytes, total, memory_order_relaxed);
+    base = (char *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+    if (base != raw)
+        sty_os_unmap(raw, (size_t)(base - raw));
+    if (raw + total != base + bytes)
+        sty_os_unmap(base + bytes, (size_t)(raw + total - (base + bytes)));
+    return base;
+}
+
+/* hugetlbfs大页不能按小于大页的粒度解除映射，此时返回非0 */
+static int
+sty_os_unmap(void *base, size_t bytes) {
+    int ret = munmap(base, bytes);
+    atomic_fetch_add_explicit(&sty_munmap_calls, 1, memory_order_relaxed);
+    if (ret == 0)
+        atomic_fetch_sub_explicit(&sty_mapped_bytes, bytes, memory_order_relaxed);
+    return ret;
+}
+
+/* 提示内核用透明大页支撑这段内存；内核不支持时没有任何影响 */
+static void
+sty_os_hugepage(void *base, size_t bytes) {
+#ifdef MADV_HUGEPAGE
+    if (atomic_load_explicit(&sty_hugepage, memory_order_relaxed) != STY_HUGEPAGE_OFF)
+        madvise(base, bytes, MADV_HUGEPAGE);
+#else
+    (void)base;
+    (void)bytes;
+#endif
+}
+
+/* 让这段内存优先从node节点分配物理页；必须在首次访问之前调用 */
+static void
+sty_os_bind(void *base, size_t bytes, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long mask[STY_NUMA_MAX / (8 * sizeof(unsigned long))] = { 0 };
+    if (sty_numa_nodes <= 1)
+        return;
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, base, bytes, STY_MPOL_PREFERRED, mask, (unsigned long)STY_NUMA_MAX + 1, 0);
+#else
+    (void)base;
+    (void)bytes;
+    (void)node;
+#endif
+}
+
+/**
+ * 开启了sty_purge_dontfork时，给刚清除过物理页的内存加上MADV_DONTFORK，返回是否成功。
+ * hugetlbfs大页不能按span的粒度切分映射，此时madvise失败，这段内存照常被子进程继承。
+ */
+static int
+sty_os_dontfork(void *base, size_t bytes) {
+#ifdef MADV_DONTFORK
+    if (atomic_load_explicit(&sty_dontfork, memory_order_relaxed))
+        return madvise(base, bytes, MADV_DONTFORK) == 0;
+#endif
+    (void)base;
+    (void)bytes;
+    return 0;
+}
+
+/* 带有MADV_DONTFORK的内存再次交给调用者之前恢复默认，否则之后fork出的子进程中它是一个空洞 */
+static void
+sty_os_dofork(void *base, size_t bytes) {
+#ifdef MADV_DOFORK
+    madvise(base, bytes, MADV_DOFORK);
+#else
+    (void)base;
+    (void)bytes;
+#endif
+}
+
+/* 当前线程所在的NUMA节点 */
+static int
+sty_numa_node(void) {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (sty_numa_nodes > 1 && syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < (unsigned)sty_numa_nodes)
+        return (int)node;
+#endif
+    return 0;
+}
+
+/* 记下由sty_heap_create创建的堆预留的一段内存，调用者必须持有heap->pages_lock；其他堆不记录 */
+static int
+sty_region_add(sty_heap *heap, char *base, size_t bytes, int large) {
+    sty_region *regions;
+    size_t cap;
+    if (!heap->user)
+        return 1;
+    if (heap->region_count == heap->region_cap) {
+        cap = heap->region_cap != 0 ? heap->region_cap * 2 : sty_page_size / sizeof(sty_region);
+        if ((regions = (sty_region *)sty_os_map(cap * sizeof(sty_region), sty_page_size)) == NULL)
+            return 0;
+        if (heap->regions != NULL) {
+            memcpy(regions, heap->regions, heap->region_count * sizeof(sty_region));
+            sty_os_unmap(heap->regions, heap->region_cap * sizeof(sty_region));
+        }
+        heap->regions = regions;
+        heap->region_cap = cap;
+    }
+    regions = &heap->regions[heap->region_count++];
+    regions->base = base;
+    regions->bytes = bytes;
+    regions->large = large;
+    return 1;
+}
+
+/**
+ * 预留一块新的内存供页源切分，调用者必须持有heap->pages_lock。策略要求hugetlbfs大页而系统没有预
+ * 留足够的大页时，退回到透明大页，并且此后不再尝试。
+ */
+static int
+sty_pages_grow(sty_heap *heap) {
+    int policy = atomic_load_explicit(&sty_hugepage, memory_order_relaxed);
+    size_t bytes = STY_HUGE_2M;
+    char *base;
+#ifdef MAP_HUGETLB
+    if (policy == STY_HUGEPAGE_2M || policy == STY_HUGEPAGE_1G) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+        if (policy == STY_HUGEPAGE_1G) {
+            bytes = STY_HUGE_1G;
+            flags |= MAP_HUGE_1GB;
+        } else {
+            flags |= MAP_HUGE_2MB;
+        }
+        atomic_fetch_add_explicit(&sty_mmap_calls, 1, memory_order_relaxed);
+        base = (char *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (base != (char *)MAP_FAILED) {
+            atomic_fetch_add_explicit(&sty_mapped_bytes, bytes, memory_order_relaxed);
+            if (!sty_region_add(heap, base, bytes, 0)) {
+                sty_os_unmap(base, bytes);
+                return 0;
+            }
+            sty_os_bind(base, bytes, heap->node);
+            heap->pages_cur = base;
+            heap->pages_end = base + bytes;
+            return 1;
+        }
+        atomic_compare_exchange_strong(&sty_hugepage, &policy, STY_HUGEPAGE_THP);
+        bytes = STY_HUGE_2M;
+    }
+#endif
+    if ((base = (char *)sty_os_map(bytes, STY_HUGE_2M)) == NULL)
+        return 0;
+    if (!sty_region_add(heap, base, bytes, 0)) {
+        sty_os_unmap(base, bytes);
+        return 0;
+    }
+    sty_os_bind(base, bytes, heap->node);
+    sty_os_hugepage(base, bytes);
+    heap->pages_cur = base;
+    heap->pages_end = base + bytes;
+    return 1;
+}
+
+/* 取出一个空闲的STY_SPAN_SIZE大小的span：先查缓存，再从预留的内存中切分 */
+static uint64_t
+sty_now_ms(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* 从dirty链表中切下所有不晚于deadline归还的span，调用者必须持有heap->pages_lock */
+static sty_span *
+sty_pages_expire(sty_heap *heap, uint64_t deadline) {
+    sty_span **link = &heap->pages_cache, *list, *span;
+    size_t n = 0;
+    while ((span = *link) != NULL && span->stamp > deadline)
+        link = &span->next;
+    list = *link;
+    *link = NULL;
+    for (span = list; span != NULL; span = span->next)
+        ++n;
+    heap->pages_cached -= n;
+    atomic_fetch_sub_explicit(&sty_dirty_bytes, n * STY_SPAN_SIZE, memory_order_relaxed);
+    return list;
+}
+
+/* 清除一串span除首页之外的物理页，再把它们挂到clean链表上 */
+static void
+sty_pages_purge(sty_heap *heap, sty_span *list) {
+    sty_span *span, *tail = NULL;
+    for (span = list; span != NULL; span = span->next) {
+        madvise((char *)span + sty_page_size, STY_SPAN_SIZE - sty_page_size, STY_MADV_PURGE);
+        span->nofork = (uint16_t)sty_os_dontfork((char *)span + sty_page_size, STY_SPAN_SIZE - sty_page_size);
+        tail = span;
+    }
+    if (tail == NULL)
+        return;
+    pthread_mutex_lock(&heap->pages_lock);
+    tail->next = heap->pages_clean;
+    heap->pages_clean = list;
+    pthread_mutex_unlock(&heap->pages_lock);
+}
+
+static void sty_large_decay(sty_heap *heap, uint64_t deadline);
+static void sty_large_trim(sty_heap *heap);
+
+/**
+ * 清除在dirty链表中停留超过衰减时间的span与空闲的大对象run。为了摊薄开销，每个堆每隔四分之一个衰减时间才真正
+ * 检查一次；force不为0时立即清除全部dirty span。
+ */
+static void
+sty_pages_decay(sty_heap *heap, int force) {
+    long decay = atomic_load_explicit(&sty_decay_ms, memory_order_relaxed);
+    uint64_t now, deadline;
+    sty_span *list;
+    if (!force && decay < 0)
+        return;
+    now = sty_now_ms();
+    pthread_mutex_lock(&heap->pages_lock);
+    if (!force && now < heap->decay_next) {
+        pthread_mutex_unlock(&heap->pages_lock);
+        return;
+    }
+    heap->decay_next = now + (decay >= 4 ? (uint64_t)decay / 4 : 1);
+    deadline = force ? UINT64_MAX : now > (uint64_t)decay ? now - (uint64_t)decay : 0;
+    list = sty_pages_expire(heap, deadline);
+    pthread_mutex_unlock(&heap->pages_lock);
+    sty_pages_purge(heap, list);
+    sty_large_decay(heap, deadline);
+}
+
+/* 其他线程正在遍历由sty_heap_create创建的堆(也可能正是本线程)时，跳过这些堆 */
+static void
+sty_purge_all(void) {
+    sty_heap *heap;
+    int i;
+    for (i = 0; i < sty_numa_nodes; ++i)
+        sty_pages_decay(&sty_heaps[i], 1);
+    if (pthread_mutex_trylock(&sty_user_lock) != 0)
+        return;
+    for (heap = sty_user_heaps; heap != NULL; heap = heap->next)
+        sty_pages_decay(heap, 1);
+    pthread_mutex_unlock(&sty_user_lock);
+}
+
+
+/* 估计的常驻内存超过上限时，立即清除所有dirty span */
+static void
+sty_rss_check(void) {
+    size_t limit = atomic_load_explicit(&sty_rss_max, memory_order_relaxed);
+    size_t dirty = atomic_load_explicit(&sty_dirty_bytes, memory_order_relaxed);
+    if (limit != 0 && dirty != 0
+        && dirty + atomic_load_explicit(&sty_active_bytes, memory_order_relaxed) > limit)
+        sty_purge_all();
+}
+
+static sty_span *
+sty_pages_span(sty_heap *heap) {
+    sty_span *span;
+    int clean = 0;
+    pthread_mutex_lock(&heap->pages_lock);
+    if ((span = heap->pages_cache) != NULL) {
+        heap->pages_cache = span->next;
+        --heap->pages_cached;
+        atomic_fetch_sub_explicit(&sty_dirty_bytes, STY_SPAN_SIZE, memory_order_relaxed);
+    } else if ((span = heap->pages_clean) != NULL) {
+        heap->pages_clean = span->next;
+        clean = 1;
+    } else if (heap->pages_cur != heap->pages_end || sty_pages_grow(heap)) {
+        span = (sty_span *)heap->pages_cur;
+        heap->pages_cur += STY_SPAN_SIZE;
+    }
+    pthread_mutex_unlock(&heap->pages_lock);
+    /* 只有clean链表中的span才保证nofork有意义，其余span的首页可能已被对象池的slab覆盖 */
+    if (clean && span->nofork) {
+        sty_os_dofork((char *)span + sty_page_size, STY_SPAN_SIZE - sty_page_size);
+        span->nofork = 0;
+    }
+    if (span != NULL)
+        atomic_fetch_add_explicit(&sty_active_bytes, STY_SPAN_SIZE, memory_order_relaxed);
+    return span;
+}
+
+static void
+sty_pages_cache_push(sty_heap *heap, sty_span *span) {
+    span->next = heap->pages_cache;
+    span->stamp = sty_now_ms();
+    heap->pages_cache = span;
+    ++heap->pages_cached;
+    atomic_fetch_add_explicit(&sty_dirty_bytes, STY_SPAN_SIZE, memory_order_relaxed);
+}
+
+static void
+sty_pages_release(sty_heap *heap, sty_span *span) {
+    atomic_fetch_sub_explicit(&sty_active_bytes, STY_SPAN_SIZE, memory_order_relaxed);
+    pthread_mutex_lock(&heap->pages_lock);
+    /* 由sty_heap_create创建的堆只清除物理页，地址空间留到销毁时整块归还 */
+    if (heap->pages_cached < atomic_load_explicit(&sty_span_cache_max, memory_order_relaxed) || heap->user) {
+        sty_pages_cache_push(heap, span);
+        span = NULL;
+    }
+    pthread_mutex_unlock(&heap->pages_lock);
+    /* 从hugetlbfs大页中切出的span无法单独解除映射，只能继续缓存 */
+    if (span != NULL && sty_os_unmap(span, STY_SPAN_SIZE) != 0) {
+        pthread_mutex_lock(&heap->pages_lock);
+        sty_pages_cache_push(heap, span);
+        pthread_mutex_unlock(&heap->pages_lock);
+    }
+    sty_pages_decay(heap, atomic_load_explicit(&sty_decay_ms, memory_order_relaxed) == 0);
+    sty_rss_check();
+}
+
+/* 内存耗尽时把页源缓存的span与空闲的大对象run全部解除映射，连同地址空间一起还给操作系统 */
+static void
+sty_pages_trim(sty_heap *heap) {
+    sty_span *list, *span;
+    pthread_mutex_lock(&heap->pages_lock);
+    list = sty_pages_expire(heap, UINT64_MAX);
+    for (span = list; span != NULL && span->next != NULL; span = span->next)
+        ;
+    if (span != NULL)
+        span->next = heap->pages_clean;
+    else
+        list = heap->pages_clean;
+    heap->pages_clean = NULL;
+    pthread_mutex_unlock(&heap->pages_lock);
+    while ((span = list) != NULL) {
+        list = span->next;
+        if (sty_os_unmap(span, STY_SPAN_SIZE) != 0) {
+            pthread_mutex_lock(&heap->pages_lock);
+            sty_pages_cache_push(heap, span);
+            pthread_mutex_unlock(&heap->pages_lock);
+        }
+    }
+    sty_large_trim(heap);
+}
+
+static sty_span *
+sty_span_new(sty_heap *heap, unsigned cls) {
+    sty_span *span = sty_pages_span(heap);
+    size_t size = sty_class_size[cls];
+    if (span == NULL)
+        return NULL;
+    span->next = span->prev = NULL;
+    span->free = NULL;
+    span->bump = (char *)span + sty_class_offset[cls];
+    span->capacity = (uint32_t)((STY_SPAN_SIZE - sty_class_offset[cls]) / size);
+    span->limit = span->bump + (size_t)span->capacity * size;
+    span->used = 0;
+    span->cls = (uint16_t)cls;
+    atomic_init(&span->remote, NULL);
+    span->pending = NULL;
+    span->heap = heap;
+    return span;
+}
+
+static void
+sty_span_link(sty_central *c, sty_span *span) {
+    span->prev = NULL;
+    span->next = c->partial;
+    if (c->partial != NULL)
+        c->partial->prev = span;
+    c->partial = span;
+}
+
+static void
+sty_span_unlink(sty_central *c, sty_span *span) {
+    if (span->prev != NULL)
+        span->prev->next = span->next;
+    else
+        c->partial = span->next;
+    if (span->next != NULL)
+        span->next->prev = span->prev;
+    span->next = span->prev = NULL;
+}
+
+/**
+ * 收回所有待回收span上的远程释放对象，调用者必须持有c->lock。完全空闲的span通过*empty带出，
+ * 由调用者在解锁后还给页源。
+ */
+static void
+sty_central_drain(sty_central *c, sty_span **empty) {
+    sty_span *span, *next;
+    void *list, *obj;
+    span = atomic_exchange_explicit(&c->pending, NULL, memory_order_acquire);
+    for (; span != NULL; span = next) {
+        /* 必须先读出pending，交换remote之后新的释放者会立即重新登记这个span */
+        next = span->pending;
+        list = atomic_exchange_explicit(&span->remote, NULL, memory_order_acquire);
+        while ((obj = list) != NULL) {
+            list = *(void **)obj;
+            *(void **)obj = span->free;
+            span->free = obj;
+            --c->used;
+            if (span->used-- == span->capacity)
+                sty_span_link(c, span);
+        }
+        /* 该类别仍有其他可用的span时，才把完全空闲的span还给页源 */
+        if (span->used == 0 && (span->prev != NULL || span->next != NULL)) {
+            sty_span_unlink(c, span);
+            --c->spans;
+            span->next = *empty;
+            *empty = span;
+        }
+    }
+}
+
+static void
+sty_pages_release_all(sty_heap *heap, sty_span *empty) {
+    sty_span *span;
+    while ((span = empty) != NULL) {
+        empty = span->next;
+        sty_pages_release(heap, span);
+    }
+}
+
+/**
+ * 中心池只在取对象时才收回远程释放的对象，分配停止后完全空闲的span会一直留在中心池里。后台线程
+ * 和sty_purge通过此函数把它们收回页源，锁被占用的类别直接跳过。
+ */
+static void
+sty_heap_drain(sty_heap *heap) {
+    sty_span *empty;
+    unsigned cls;
+    for (cls = 0; cls < STY_NUM_CLASSES; ++cls) {
+        sty_central *c = &heap->centrals[cls];
+        if (atomic_load_explicit(&c->pending, memory_order_relaxed) == NULL
+            || pthread_mutex_trylock(&c->lock) != 0)
+            continue;
+        empty = NULL;
+        sty_central_drain(c, &empty);
+        pthread_mutex_unlock(&c->lock);
+        sty_pages_release_all(heap, empty);
+    }
+}
+
+/**
+ * 在一次加锁中从中心池取出至多n个对象，串成链表存入*head，返回实际取得的个数。
+ */
+static uint32_t
+sty_central_fetch(sty_heap *heap, unsigned cls, uint32_t n, void **head) {
+    sty_central *c = &heap->centrals[cls];
+    size_t size = sty_class_size[cls];
+    sty_span *span, *empty = NULL;
+    void *list = NULL, *obj;
+    uint32_t got = 0;
+    pthread_mutex_lock(&c->lock);
+    if (atomic_load_explicit(&c->pending, memory_order_relaxed) != NULL)
+        sty_central_drain(c, &empty);
+    while (got < n) {
+        if ((span = c->partial) == NULL) {
+            if ((span = sty_span_new(heap, cls)) == NULL)
+                break;
+            sty_span_link(c, span);
+            ++c->spans;
+        }
+        while (got < n && span->used < span->capacity) {
+            if ((obj = span->free) != NULL) {
+                span->free = *(void **)obj;
+            } else {
+                obj = span->bump;
+                span->bump += size;
+#ifdef STY_DEBUG
+                /* span可能曾经属于别的类别，清掉这个位置上残留的释放标记 */
+                memset((char *)obj + size - 8, 0, 8);
+#endif
+            }
+            *(void **)obj = list;
+            list = obj;
+            ++span->used;
+            ++got;
+        }
+        if (span->used == span->capacity)
+            sty_span_unlink(c, span);
+    }
+    c->used += got;
+    pthread_mutex_unlock(&c->lock);
+    sty_pages_release_all(heap, empty);
+    *head = list;
+    return got;
+}
+
+/* 把[head, tail]这一段同属span的对象压入其远程释放链表 */
+static void
+sty_remote_push(sty_span *span, void *head, void *tail) {
+    sty_central *c;
+    sty_span *top;
+    void *old = atomic_load_explicit(&span->remote, memory_order_relaxed);
+    do {
+        *(void **)tail = old;
+    } while (!atomic_compare_exchange_weak_explicit(&span->remote, &old, head,
+                                                    memory_order_release, memory_order_relaxed));
+    if (old != NULL)
+        return;
+    c = &span->heap->centrals[span->cls];
+    top = atomic_load_explicit(&c->pending, memory_order_relaxed);
+    do {
+        span->pending = top;
+    } while (!atomic_compare_exchange_weak_explicit(&c->pending, &top, span,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * 把一条对象链表无锁地还给各自的span。相邻且属于同一span的对象只需一次CAS。
+ */
+static void
+sty_central_return(void *list) {
+    sty_span *span;
+    void *head, *tail;
+    while ((head = list) != NULL) {
+        span = (sty_span *)((uintptr_t)head & STY_SPAN_MASK);
+        tail = head;
+        list = *(void **)tail;
+        while (list != NULL && ((uintptr_t)list & STY_SPAN_MASK) == (uintptr_t)span) {
+            tail = list;
+            list = *(void **)tail;
+        }
+        sty_remote_push(span, head, tail);
+    }
+}
+
+/* 当前线程绑定的堆；首次调用时按线程所在的NUMA节点绑定，析构之后只借用所在节点的堆 */
+static sty_heap *
+sty_tcache_heap(void) {
+    if ((uintptr_t)sty_tc.heap <= (uintptr_t)STY_TCACHE_DEAD) {
+        pthread_once(&sty_once, sty_init);
+        if (sty_tc.heap == STY_TCACHE_DEAD)
+            return &sty_heaps[sty_numa_node()];
+        sty_tc.heap = &sty_heaps[sty_numa_node()];
+        pthread_mutex_lock(&sty_threads_lock);
+        sty_tc.prev = NULL;
+        sty_tc.next = sty_threads;
+        if (sty_threads != NULL)
+            sty_threads->prev = &sty_tc;
+        sty_threads = &sty_tc;
+        pthread_mutex_unlock(&sty_threads_lock);
+        pthread_setspecific(sty_tc_key, &sty_tc);
+    }
+    return sty_tc.heap;
+}
+
+#if STY_TRANSFER
+static sty_batch *
+sty_transfer_pop(sty_central *c, _Atomic(uint64_t) *stack) {
+    uint64_t old = atomic_load_explicit(stack, memory_order_acquire), top;
+    uint32_t i;
+    do {
+        if ((i = (uint32_t)old) == 0)
+            return NULL;
+        top = ((old >> 32) + 1) << 32 | atomic_load_explicit(&c->slots[i - 1].next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(stack, &old, top, memory_order_acquire, memory_order_acquire));
+    return &c->slots[i - 1];
+}
+
+static void
+sty_transfer_push(sty_central *c, _Atomic(uint64_t) *stack, sty_batch *batch) {
+    uint64_t old = atomic_load_explicit(stack, memory_order_relaxed), top;
+    uint32_t i = (uint32_t)(batch - c->slots) + 1;
+    do {
+        atomic_store_explicit(&batch->next, (uint32_t)old, memory_order_relaxed);
+        top = ((old >> 32) + 1) << 32 | i;
+    } while (!atomic_compare_exchange_weak_explicit(stack, &old, top, memory_order_release, memory_order_relaxed));
+}
+#endif
+
+/* 把恰好一批对象放入转移缓存，缓存已满时返回0 */
+static int
+sty_transfer_put(sty_central *c, void *list) {
+#if STY_TRANSFER
+    sty_batch *batch = sty_transfer_pop(c, &c->empty);
+    if (batch == NULL)
+        return 0;
+    batch->head = list;
+    sty_transfer_push(c, &c->full, batch);
+    atomic_fetch_add_explicit(&c->batches, 1, memory_order_relaxed);
+    return 1;
+#else
+    (void)c;
+    (void)list;
+    return 0;
+#endif
+}
+
+/* 从转移缓存中取走一批对象，缓存为空时返回NULL */
+static void *
+sty_transfer_get(sty_central *c) {
+#if STY_TRANSFER
+    sty_batch *batch = sty_transfer_pop(c, &c->full);
+    void *list;
+    if (batch == NULL)
+        return NULL;
+    list = batch->head;
+    sty_transfer_push(c, &c->empty, batch);
+    atomic_fetch_sub_explicit(&c->batches, 1, memory_order_relaxed);
+    return list;
+#else
+    (void)c;
+    return NULL;
+#endif
+}
+
+/* 把转移缓存中的对象全部还给各自的span，使完全空闲的span能够回到页源 */
+static void
+sty_transfer_flush(sty_heap *heap) {
+    unsigned cls;
+    void *list;
+    for (cls = 0; cls < STY_NUM_CLASSES; ++cls) {
+        while ((list = sty_transfer_get(&heap->centrals[cls])) != NULL)
+            sty_central_return(list);
+    }
+}
+
+/* 先从转移缓存整批取得对象，为空时才在锁内从span中切分；析构之后的线程每次只取一个对象 */
+static void *
+sty_tcache_refill(sty_bin *bin, unsigned cls) {
+    sty_heap *heap = sty_tcache_heap();
+    void *list, *obj;
+    uint32_t got;
+    if (sty_tc.heap == STY_TCACHE_DEAD) {
+        if (sty_central_fetch(heap, cls, 1, &obj) == 0)
+            return NULL;
+        ++bin->allocs;
+        sty_tcache_dead_retire();
+        return obj;
+    }
+    if ((list = sty_transfer_get(&heap->centrals[cls])) != NULL)
+        got = sty_class_batch[cls];
+    else if ((got = sty_central_fetch(heap, cls, sty_class_batch[cls], &list)) == 0)
+        return NULL;
+    obj = list;
+    bin->head = *(void **)obj;
+    bin->count = got - 1;
+    ++bin->allocs;
+    return obj;
+}
+
+/* 只保留最近释放的keep个对象，返回切下的较早的对象 */
+static void *
+sty_tcache_cut(sty_bin *bin, uint32_t keep) {
+    uint32_t i;
+    void *last = bin->head, *list;
+    for (i = 1; i < keep; ++i)
+        last = *(void **)last;
+    list = *(void **)last;
+    *(void **)last = NULL;
+    bin->count = keep;
+    return list;
+}
+
+static void
+sty_tcache_trim(sty_bin *bin, uint32_t keep) {
+    sty_central_return(sty_tcache_cut(bin, keep));
+}
+
+/**
+ * 线程缓存过长：保留最近释放的一半，把较早的一批整批放入转移缓存，转移缓存已满时才逐个还给span。
+ * 线程缓存中的对象都属于同一个堆，但线程可能尚未绑定堆，所以由对象所在的span找到中心池。
+ */
+static void
+sty_tcache_flush(sty_bin *bin, unsigned cls) {
+    void *list = sty_tcache_cut(bin, bin->count - sty_class_batch[cls]);
+    sty_span *span = (sty_span *)((uintptr_t)list & STY_SPAN_MASK);
+    if (!sty_transfer_put(&span->heap->centrals[cls], list))
+        sty_central_return(list);
+}
+
+#if STY_RSEQ
+/**
+ * 每CPU缓存。每个CPU一块STY_CPU_SLAB字节的slab：开头是每个尺寸类别一个的对象个数，其后是各类别
+ * 的对象指针数组，容量为sty_class_cache[cls]。快路径是一段restartable sequence：从rseq区域读出
+ * cpu_id，找到该CPU的slab，读写指针数组，最后以一次普通的存储提交新的对象个数。线程在提交之前被
+ * 抢占、迁移或收到信号时，内核把它送到abort处理程序，从头再来一次，所以既不需要原子操作也不需要锁。
+ * rseq区域由glibc为每个线程注册；被禁用或注册失败时cpu_id不是有效的CPU编号，快路径总是失败，
+ * 分配与释放退回线程缓存。slab的页只在某个CPU第一次缓存对象时才被触碰。
+ * 线程的rseq区域在离开临界区之后仍然指向这里的描述符，所以包含sty的共享库不能被dlclose卸载。
+ */
+#define STY_CPU_SLAB_SHIFT  13
+#define STY_CPU_SLAB        ((size_t)1 << STY_CPU_SLAB_SHIFT)
+#define STY_CPU_MAX         4096
+
+_Static_assert(RSEQ_SIG == 0x53053053, "the abort signature below must match the one glibc registers");
+
+/* rseq_cs描述符，起止地址与abort处理程序分别是标号1、2与4 */
+#define STY_RSEQ_CS                                                         \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                                    \
+    ".balign 32\n\t"                                                        \
+    "3:\n\t"                                                                \
+    ".long 0, 0\n\t"                                                        \
+    ".quad 1f, 2f - 1f, 4f\n\t"                                             \
+    ".popsection\n\t"
+
+/* abort处理程序之前紧跟签名，内核只跳转到签名匹配的地址 */
+#define STY_RSEQ_ABORT                                                      \
+    ".byte 0x0f, 0xb9, 0x3d\n\t"                                            \
+    ".long 0x53053053\n\t"                                                  \
+    "4:\n\t"                                                                \
+    "jmp 0b\n\t"
+
+static char                *sty_cpu_slabs;
+static uint32_t             sty_cpu_count;      /* 0表示不使用每CPU缓存 */
+static uint64_t             sty_cpu_begin[STY_NUM_CLASSES];     /* 指针数组在slab中的下标 */
+static uint64_t             sty_cpu_cap[STY_NUM_CLASSES];
+
+static inline struct rseq *
+sty_rseq(void) {
+    return (struct rseq *)((char *)__builtin_thread_pointer() + __rseq_offset);
+}
+
+/* 当前线程正运行在一个登记了rseq且有slab的CPU上 */
+static int
+sty_cpu_on(void) {
+    return *(volatile uint32_t *)&sty_rseq()->cpu_id < sty_cpu_count;
+}
+
+static void
+sty_cpu_init(void) {
+    uint64_t next = STY_NUM_CLASSES, cap;
+    int cls, count;
+    if (__rseq_size == 0)
+        return;
+    count = sty_sysfs_count("/sys/devices/system/cpu/possible", STY_CPU_MAX);
+    for (cls = 0; cls < STY_NUM_CLASSES; ++cls) {
+        cap = sty_class_cache[cls];
+        if (cap > STY_CPU_SLAB / sizeof(void *) - next)
+            cap = STY_CPU_SLAB / sizeof(void *) - next;
+        sty_cpu_begin[cls] = next;
+        sty_cpu_cap[cls] = cap;
+        next += cap;
+    }
+    if ((sty_cpu_slabs = (char *)sty_os_map((size_t)count << STY_CPU_SLAB_SHIFT, sty_page_size)) != NULL)
+        sty_cpu_count = (uint32_t)count;
+}
+
+/* 从当前CPU的缓存中取出最近放入的对象，缓存为空或不可用时返回NULL */
+static inline void *
+sty_cpu_pop(unsigned cls) {
+    uint64_t cur, tmp;
+    char *slab;
+    void *obj;
+    __asm__ __volatile__(
+        STY_RSEQ_CS
+        "0:\n\t"
+        "xorl %k[obj], %k[obj]\n\t"
+        "leaq 3b(%%rip), %[tmp]\n\t"
+        "movq %[tmp], %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "movl %c[cpu](%[rs]), %k[slab]\n\t"
+        "cmpl %[count], %k[slab]\n\t"
+        "jae 2f\n\t"
+        "shlq %[shift], %[slab]\n\t"
+        "addq %[slabs], %[slab]\n\t"
+        "movq (%[slab], %[cls], 8), %[cur]\n\t"
+        "testq %[cur], %[cur]\n\t"
+        "jz 2f\n\t"
+        "leaq -1(%[begin], %[cur]), %[tmp]\n\t"
+        "movq (%[slab], %[tmp], 8), %[obj]\n\t"
+        "decq %[cur]\n\t"
+        "movq %[cur], (%[slab], %[cls], 8)\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        STY_RSEQ_ABORT
+        ".popsection\n\t"
+        : [obj] "=&r" (obj), [cur] "=&r" (cur), [tmp] "=&r" (tmp), [slab] "=&r" (slab)
+        : [rs] "r" (sty_rseq()), [cs] "i" (offsetof(struct rseq, rseq_cs)),
+          [cpu] "i" (offsetof(struct rseq, cpu_id)), [count] "r" (sty_cpu_count),
+          [shift] "i" (STY_CPU_SLAB_SHIFT), [slabs] "r" (sty_cpu_slabs),
+          [cls] "r" ((uint64_t)cls), [begin] "r" (sty_cpu_begin[cls])
+        : "memory", "cc");
+    return obj;
+}
+
+/* 把obj放入当前CPU的缓存，缓存已满或不可用时返回0 */
+static inline int
+sty_cpu_push(unsigned cls, void *obj) {
+    uint64_t cur, tmp;
+    char *slab;
+    int ok;
+    __asm__ __volatile__(
+        STY_RSEQ_CS
+        "0:\n\t"
+        "movl $1, %[ok]\n\t"
+        "leaq 3b(%%rip), %[tmp]\n\t"
+        "movq %[tmp], %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "movl %c[cpu](%[rs]), %k[slab]\n\t"
+        "cmpl %[count], %k[slab]\n\t"
+        "jae 5f\n\t"
+        "shlq %[shift], %[slab]\n\t"
+        "addq %[slabs], %[slab]\n\t"
+        "movq (%[slab], %[cls], 8), %[cur]\n\t"
+        "cmpq %[cap], %[cur]\n\t"
+        "jae 5f\n\t"
+        "leaq (%[begin], %[cur]), %[tmp]\n\t"
+        "movq %[obj], (%[slab], %[tmp], 8)\n\t"
+        "incq %[cur]\n\t"
+        "movq %[cur], (%[slab], %[cls], 8)\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        "5:\n\t"
+        "xorl %[ok], %[ok]\n\t"
+        "jmp 2b\n\t"
+        STY_RSEQ_ABORT
+        ".popsection\n\t"
+        : [ok] "=&r" (ok), [cur] "=&r" (cur), [tmp] "=&r" (tmp), [slab] "=&r" (slab)
+        : [rs] "r" (sty_rseq()), [cs] "i" (offsetof(struct rseq, rseq_cs)),
+          [cpu] "i" (offsetof(struct rseq, cpu_id)), [count] "r" (sty_cpu_count),
+          [shift] "i" (STY_CPU_SLAB_SHIFT), [slabs] "r" (sty_cpu_slabs),
+          [cls] "r" ((uint64_t)cls), [begin] "r" (sty_cpu_begin[cls]),
+          [cap] "r" (sty_cpu_cap[cls]), [obj] "r" (obj)
+        : "memory", "cc");
+    return ok;
+}
+
+/**
+ * 在一次restartable sequence中把objs[0, n)依次放入当前CPU的缓存，直到缓存放满，返回放入的个数。
+ * 中途被打断时，已经写入指针数组的对象还没有提交，重来一次即可。
+ */
+static uint32_t
+sty_cpu_push_batch(unsigned cls, void **objs, uint32_t n) {
+    uint64_t cur, tmp, i, obj;
+    char *slab;
+    uint64_t k;
+    __asm__ __volatile__(
+        STY_RSEQ_CS
+        "0:\n\t"
+        "leaq 3b(%%rip), %[tmp]\n\t"
+        "movq %[tmp], %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "movl %c[cpu](%[rs]), %k[slab]\n\t"
+        "cmpl %[count], %k[slab]\n\t"
+        "jae 5f\n\t"
+        "shlq %[shift], %[slab]\n\t"
+        "addq %[slabs], %[slab]\n\t"
+        "movq (%[slab], %[cls], 8), %[cur]\n\t"
+        "movq %[cap], %[k]\n\t"
+        "subq %[cur], %[k]\n\t"
+        "cmpq %[n], %[k]\n\t"
+        "cmovaq %[n], %[k]\n\t"
+        "testq %[k], %[k]\n\t"
+        "jz 2f\n\t"
+        "movq %[begin], %[tmp]\n\t"
+        "addq %[cur], %[tmp]\n\t"
+        "leaq (%[slab], %[tmp], 8), %[tmp]\n\t"
+        "xorl %k[i], %k[i]\n\t"
+        "6:\n\t"
+        "movq (%[objs], %[i], 8), %[obj]\n\t"
+        "movq %[obj], (%[tmp], %[i], 8)\n\t"
+        "incq %[i]\n\t"
+        "cmpq %[k], %[i]\n\t"
+        "jb 6b\n\t"
+        "addq %[k], %[cur]\n\t"
+        "movq %[cur], (%[slab], %[cls], 8)\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        "5:\n\t"
+        "xorl %k[k], %k[k]\n\t"
+        "jmp 2b\n\t"
+        STY_RSEQ_ABORT
+        ".popsection\n\t"
+        : [k] "=&r" (k), [cur] "=&r" (cur), [tmp] "=&r" (tmp), [slab] "=&r" (slab),
+          [i] "=&r" (i), [obj] "=&r" (obj)
+        : [rs] "r" (sty_rseq()), [cs] "i" (offsetof(struct rseq, rseq_cs)),
+          [cpu] "i" (offsetof(struct rseq, cpu_id)), [count] "m" (sty_cpu_count),
+          [shift] "i" (STY_CPU_SLAB_SHIFT), [slabs] "m" (sty_cpu_slabs),
+          [cls] "r" ((uint64_t)cls), [begin] "m" (sty_cpu_begin[cls]),
+          [cap] "m" (sty_cpu_cap[cls]), [objs] "r" (objs), [n] "r" ((uint64_t)n)
+        : "memory", "cc");
+    return (uint32_t)k;
+}
+
+/* 在一次restartable sequence中从当前CPU的缓存取出至多n个对象存入objs，最近放入的在前 */
+static uint32_t
+sty_cpu_pop_batch(unsigned cls, void **objs, uint32_t n) {
+    uint64_t cur, tmp, i, obj;
+    char *slab;
+    uint64_t k;
+    __asm__ __volatile__(
+        STY_RSEQ_CS
+        "0:\n\t"
+        "leaq 3b(%%rip), %[tmp]\n\t"
+        "movq %[tmp], %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "movl %c[cpu](%[rs]), %k[slab]\n\t"
+        "cmpl %[count], %k[slab]\n\t"
+        "jae 5f\n\t"
+        "shlq %[shift], %[slab]\n\t"
+        "addq %[slabs], %[slab]\n\t"
+        "movq (%[slab], %[cls], 8), %[cur]\n\t"
+        "movq %[n], %[k]\n\t"
+        "cmpq %[cur], %[k]\n\t"
+        "cmovaq %[cur], %[k]\n\t"
+        "testq %[k], %[k]\n\t"
+        "jz 2f\n\t"
+        "movq %[begin], %[tmp]\n\t"
+        "addq %[cur], %[tmp]\n\t"
+        "leaq -8(%[slab], %[tmp], 8), %[tmp]\n\t"
+        "xorl %k[i], %k[i]\n\t"
+        "6:\n\t"
+        "movq (%[tmp]), %[obj]\n\t"
+        "movq %[obj], (%[objs], %[i], 8)\n\t"
+        "subq $8, %[tmp]\n\t"
+        "incq %[i]\n\t"
+        "cmpq %[k], %[i]\n\t"
+        "jb 6b\n\t"
+        "subq %[k], %[cur]\n\t"
+        "movq %[cur], (%[slab], %[cls], 8)\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        "5:\n\t"
+        "xorl %k[k], %k[k]\n\t"
+        "jmp 2b\n\t"
+        STY_RSEQ_ABORT
+        ".popsection\n\t"
+        : [k] "=&r" (k), [cur] "=&r" (cur), [tmp] "=&r" (tmp), [slab] "=&r" (slab),
+          [i] "=&r" (i), [obj] "=&r" (obj)
+        : [rs] "r" (sty_rseq()), [cs] "i" (offsetof(struct rseq, rseq_cs)),
+          [cpu] "i" (offsetof(struct rseq, cpu_id)), [count] "m" (sty_cpu_count),
+          [shift] "i" (STY_CPU_SLAB_SHIFT), [slabs] "m" (sty_cpu_slabs),
+          [cls] "r" ((uint64_t)cls), [begin] "m" (sty_cpu_begin[cls]),
+          [objs] "r" (objs), [n] "r" ((uint64_t)n)
+        : "memory", "cc");
+    return (uint32_t)k;
+}
+
+/* 把objs[0, n)按原来的顺序串成链表 */
+static void *
+sty_cpu_link(void **objs, uint32_t n) {
+    void *list = NULL;
+    while (n > 0) {
+        *(void **)objs[--n] = list;
+        list = objs[n];
+    }
+    return list;
+}
+
+/**
+ * 当前CPU的缓存为空：整批取得对象，留下一个返回给调用者，其余一次放入CPU缓存。期间线程可能被
+ * 迁移，对象于是落在另一个CPU的缓存中，这并不影响正确性；放不下的对象还给各自的span。
+ */
+static void *
+sty_cpu_refill(unsigned cls) {
+    sty_heap *heap = sty_tcache_heap();
+    void *objs[STY_BATCH_MAX], *list, *obj;
+    uint32_t n = 0, k;
+    if ((list = sty_transfer_get(&heap->centrals[cls])) == NULL
+        && sty_central_fetch(heap, cls, sty_class_batch[cls], &list) == 0)
+        return NULL;
+    obj = list;
+    for (list = *(void **)obj; list != NULL; list = *(void **)list)
+        objs[n++] = list;
+    k = sty_cpu_push_batch(cls, objs, n);
+    sty_central_return(sty_cpu_link(objs + k, n - k));
+    return obj;
+}
+
+/**
+ * 当前CPU的缓存已满：取出最近放入的一批对象整批放入转移缓存，再放入obj。取出期间线程被迁移时可能
+ * 凑不满一批，这时逐个还给span。CPU缓存不可用时返回0。
+ */
+static int
+sty_cpu_flush(unsigned cls, void *obj) {
+    void *objs[STY_BATCH_MAX], *list;
+    uint32_t n;
+    sty_span *span;
+    if (!sty_cpu_on())
+        return 0;
+    n = sty_cpu_pop_batch(cls, objs, sty_class_batch[cls]);
+    if (!sty_cpu_push(cls, obj)) {
+        *(void **)obj = NULL;
+        sty_central_return(obj);
+    }
+    if ((list = sty_cpu_link(objs, n)) == NULL)
+        return 1;
+    span = (sty_span *)((uintptr_t)list & STY_SPAN_MASK);
+    if (n < sty_class_batch[cls] || !sty_transfer_put(&span->heap->centrals[cls], list))
+        sty_central_return(list);
+    return 1;
+}
+
+/* 把当前CPU缓存的对象全部还给各自的span */
+static void
+sty_cpu_drain(void) {
+    void *objs[STY_BATCH_MAX];
+    unsigned cls;
+    uint32_t n;
+    for (cls = 0; cls < STY_NUM_CLASSES; ++cls) {
+        while ((n = sty_cpu_pop_batch(cls, objs, STY_BATCH_MAX)) > 0)
+            sty_central_return(sty_cpu_link(objs, n));
+    }
+}
+
+/**
+ * rseq只能操作当前CPU的缓存，所以依次把线程绑定到允许运行的每个CPU上清空它的缓存，最后恢复原来
+ * 的CPU亲和性。不允许本线程运行的CPU上缓存的对象留在原处。
+ */
+static void
+sty_cpu_drain_all(void) {
+    pthread_t self = pthread_self();
+    cpu_set_t allowed, one;
+    uint32_t cpu;
+    if (sty_cpu_count == 0)
+        return;
+    if (pthread_getaffinity_np(self, sizeof(allowed), &allowed) != 0) {
+        sty_cpu_drain();
+        return;
+    }
+    for (cpu = 0; cpu < sty_cpu_count && cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (pthread_setaffinity_np(self, sizeof(one), &one) == 0)
+            sty_cpu_drain();
+    }
+    pthread_setaffinity_np(self, sizeof(allowed), &allowed);
+}
+#endif
+
+static void *
+sty_small_alloc(unsigned cls) {
+    sty_bin *bin = &sty_tc.bins[cls];
+    void *obj;
+#if STY_RSEQ
+    if ((obj = sty_cpu_pop(cls)) != NULL) {
+        ++bin->allocs;
+        return obj;
+    }
+    sty_tcache_heap();      /* 首次分配时初始化，之后才知道每CPU缓存是否可用 */
+    if (sty_cpu_on()) {
+        if ((obj = sty_cpu_refill(cls)) != NULL)
+            ++bin->allocs;
+        return obj;
+    }
+#endif
+    obj = bin->head;
+    if (obj != NULL) {
+        bin->head = *(void **)obj;
+        --bin->count;
+        ++bin->allocs;
+        return obj;
+    }
+    return sty_tcache_refill(bin, cls);
+}
+
+static void
+sty_small_free(unsigned cls, void *obj) {
+    sty_bin *bin = &sty_tc.bins[cls];
+#if STY_RSEQ
+    if (sty_cpu_push(cls, obj) || sty_cpu_flush(cls, obj)) {
+        ++bin->frees;
+        return;
+    }
+#endif
+    *(void **)obj = bin->head;
+    bin->head = obj;
+    ++bin->frees;
+    if (++bin->count > sty_class_cache[cls])
+        sty_tcache_flush(bin, cls);
+}
+
+/* 对象不属于当前线程绑定的堆：尚未绑定时先绑定，否则直接送回其所属的堆；析构之后的线程同样如此 */
+static void
+sty_small_free_foreign(sty_span *span, void *obj) {
+    if (span->heap == sty_tcache_heap() && sty_tc.heap != STY_TCACHE_DEAD) {
+        sty_small_free(span->cls, obj);
+        return;
+    }
+    ++sty_tc.bins[span->cls].frees;
+    sty_remote_push(span, obj, obj);
+    if (sty_tc.heap == STY_TCACHE_DEAD)
+        sty_tcache_dead_retire();
+}
+
+static void sty_pool_evict(sty_pool_bin *bin);
+
+/* 把线程缓存中各个尺寸类别的对象还给中心池，调用者必须是tc的所有者 */
+static void
+sty_tcache_release_classes(sty_tcache *tc) {
+    unsigned cls;
+    void *list;
+    for (cls = 0; cls < STY_NUM_CLASSES; ++cls) {
+        list = tc->bins[cls].head;
+        tc->bins[cls].head = NULL;
+        tc->bins[cls].count = 0;
+        sty_central_return(list);
+    }
+}
+
+/* 把线程缓存的对象全部还给中心池与各自的对象池，调用者必须是tc的所有者 */
+static void
+sty_tcache_release(sty_tcache *tc) {
+    unsigned cls;
+    sty_tcache_release_classes(tc);
+    for (cls = 0; cls < STY_POOL_TCACHE; ++cls)
+        sty_pool_evict(&tc->pools[cls]);
+}
+
+/**
+ * 第attempt次(从0开始)分配bytes字节失败后调用，返回非0表示应当再试一次。每次失败都先把当前
+ * 线程缓存和所有页源缓存的内存还给操作系统，再询问内存耗尽处理函数；没有注册处理函数时最多重试
+ * sty_oom_retry次。第一次重试立即进行，之后的等待时间从1毫秒起倍增，直到
+ * STY_OOM_BACKOFF_MAX毫秒为止，给其他线程释放内存的时间。
+ */
+static int
+sty_oom(size_t bytes, int attempt) {
+    sty_oom_handler_t handler = atomic_load_explicit(&sty_oom_fn, memory_order_acquire);
+    struct timespec ts;
+    long ms;
+    int i;
+    /* 对象池补充slab时持有pool->lock进入这里，不能再把对象池的缓存项还回去 */
+    sty_tcache_release_classes(&sty_tc);
+#if STY_RSEQ
+    sty_cpu_drain();
+#endif
+    for (i = 0; i < sty_numa_nodes; ++i) {
+        sty_transfer_flush(&sty_heaps[i]);
+        sty_heap_drain(&sty_heaps[i]);
+        sty_pages_trim(&sty_heaps[i]);
+    }
+    /* 由sty_heap_create创建的堆不能单独解除映射，只清除它们的物理页 */
+    sty_purge_all();
+    if (handler != NULL ? handler(bytes, attempt) == 0
+                        : attempt >= atomic_load_explicit(&sty_oom_retry, memory_order_relaxed))
+        return 0;
+    if (attempt > 0) {
+        ms = attempt < 8 ? 1L << (attempt - 1) : STY_OOM_BACKOFF_MAX;
+        if (ms > STY_OOM_BACKOFF_MAX)
+            ms = STY_OOM_BACKOFF_MAX;
+        ts.tv_sec = 0;
+        ts.tv_nsec = ms * 1000000;
+        nanosleep(&ts, NULL);
+    }
+    return 1;
+}
+
+/**
+ * 大对象的页堆。超过STY_SMALL_MAX的请求按页取整后从堆自己的页堆中切出一个run。页映射表是一棵
+ * 以地址右移STY_PAGE_SHIFT位得到的页号为键的两层基数树，只登记每个run的首页与末页：释放时由首页
+ * 一次查表找到描述符，合并时由相邻的页号找到左右两侧的run。run内部的页永远不登记，小对象所在的
+ * 页也从不登记。
+ * 被释放的run与相邻的同状态空闲run合并，再按大小放入分档的空闲链表：STY_RUN_EXACT页以内每页一
+ * 档，此后每翻一倍细分为4档。分配时先在所需的档内选最合适的一个，没有时取更大的档中的第一个，
+ * 多出的部分放回空闲链表；dirty的run优先于clean的run被复用。dirty的run与小对象的页源一样，经过
+ * 衰减时间后清除物理页并转为clean。页堆用完时以2 MiB为单位向操作系统预留新的内存。
+ * 超过sty_direct_min的对象独占一段映射，释放时直接解除映射，realloc时用mremap搬移页表项。
+ */
+
+/* 返回page所在的叶节点，必要时创建；地址超出页映射表的范围或内存耗尽时返回NULL */
+static sty_page_entry *
+sty_pagemap_leaf(uint64_t page) {
+    size_t i = (size_t)(page >> STY_PAGEMAP_LEAF);
+    sty_page_entry *leaf;
+    if (page >> STY_PAGEMAP_BITS != 0)
+        return NULL;
+    if ((leaf = atomic_load_explicit(&sty_pagemap[i], memory_order_acquire)) != NULL)
+        return leaf;
+    pthread_mutex_lock(&sty_pagemap_lock);
+    if ((leaf = atomic_load_explicit(&sty_pagemap[i], memory_order_relaxed)) == NULL) {
+        leaf = (sty_page_entry *)sty_os_map(sizeof(sty_page_entry) << STY_PAGEMAP_LEAF, sty_page_size);
+        if (leaf != NULL)
+            atomic_store_explicit(&sty_pagemap[i], leaf, memory_order_release);
+    }
+    pthread_mutex_unlock(&sty_pagemap_lock);
+    return leaf;
+}
+
+/* 为[base, base + bytes)准备好叶节点，此后登记其中的页不会失败 */
+static int
+sty_pagemap_reserve(const char *base, size_t bytes) {
+    uint64_t page = (uint64_t)(uintptr_t)base >> STY_PAGE_SHIFT;
+    uint64_t last = (uint64_t)((uintptr_t)base + bytes - 1) >> STY_PAGE_SHIFT;
+    for (;; page += (uint64_t)1 << STY_PAGEMAP_LEAF) {
+        if (sty_pagemap_leaf(page) == NULL)
+            return 0;
+        if (page >> STY_PAGEMAP_LEAF == last >> STY_PAGEMAP_LEAF)
+            return 1;
+    }
+}
+
+static void
+sty_pagemap_set(const char *addr, sty_run *run) {
+    uint64_t page = (uint64_t)(uintptr_t)addr >> STY_PAGE_SHIFT;
+    sty_page_entry *leaf = atomic_load_explicit(&sty_pagemap[page >> STY_PAGEMAP_LEAF], memory_order_relaxed);
+    atomic_store_explicit(&leaf[page & (((uint64_t)1 << STY_PAGEMAP_LEAF) - 1)], run, memory_order_relaxed);
+}
+
+/* ptr所在页登记的run；小对象总是返回NULL */
+static inline sty_run *
+sty_pagemap_get(const void *ptr) {
+    uint64_t page = (uint64_t)(uintptr_t)ptr >> STY_PAGE_SHIFT;
+    sty_page_entry *leaf;
+    if (page >> STY_PAGEMAP_BITS != 0)
+        return NULL;
+    leaf = atomic_load_explicit(&sty_pagemap[page >> STY_PAGEMAP_LEAF], memory_order_relaxed);
+    if (leaf == NULL)
+        return NULL;
+    return atomic_load_explicit(&leaf[page & (((uint64_t)1 << STY_PAGEMAP_LEAF) - 1)], memory_order_relaxed);
+}
+
+/* 登记或注销run的首页与末页，调用者必须持有run->heap->large_lock */
+static void
+sty_run_map(sty_run *run) {
+    sty_pagemap_set(run->base, run);
+    sty_pagemap_set(run->base + run->bytes - 1, run);
+}
+
+static void
+sty_run_unmap(sty_run *run) {
+    sty_pagemap_set(run->base, NULL);
+    sty_pagemap_set(run->base + run->bytes - 1, NULL);
+}
+
+/* 取一个空闲的描述符，不够时从页源取一个span切分，调用者必须持有heap->large_lock */
+static sty_run *
+sty_run_new(sty_heap *heap) {
+    sty_run *run;
+    char *p, *end;
+    if (heap->run_spare == NULL) {
+        if ((p = (char *)sty_pages_span(heap)) == NULL)
+            return NULL;
+        for (end = p + STY_SPAN_SIZE; p + sizeof(sty_run) <= end; p += sizeof(sty_run)) {
+            run = (sty_run *)p;
+            run->heap = heap;
+            run->next = heap->run_spare;
+            heap->run_spare = run;
+        }
+    }
+    run = heap->run_spare;
+    heap->run_spare = run->next;
+    run->next = run->prev = NULL;
+    run->sample = NULL;
+    run->nofork = 0;
+    return run;
+}
+
+static void
+sty_run_delete(sty_heap *heap, sty_run *run) {
+    run->next = heap->run_spare;
+    heap->run_spare = run;
+}
+
+static unsigned
+sty_run_bin(size_t bytes) {
+    size_t pages = bytes >> STY_PAGE_SHIFT;
+    unsigned lg = 6, bin;
+    if (pages <= STY_RUN_EXACT)
+        return (unsigned)pages - 1;
+    while (pages >> (lg + 1) != 0)
+        ++lg;
+    bin = STY_RUN_EXACT + (lg - 6) * 4 + (unsigned)((pages >> (lg - 2)) & 3);
+    return bin < STY_RUN_BINS ? bin : STY_RUN_BINS - 1;
+}
+
+/* 不小于bin的第一个非空的档，没有时返回STY_RUN_BINS */
+static unsigned
+sty_run_next_bin(const uint64_t *bits, unsigned bin) {
+    uint64_t word;
+    while (bin < STY_RUN_BINS) {
+        if ((word = bits[bin >> 6] >> (bin & 63)) == 0) {
+            bin = (bin | 63) + 1;
+            continue;
+        }
+        while ((word & 1) == 0) {
+            word >>= 1;
+            ++bin;
+        }
+        return bin;
+    }
+    return STY_RUN_BINS;
+}
+
+/* 把空闲的run放入其状态对应的空闲链表，调用者必须持有heap->large_lock */
+static void
+sty_run_push(sty_heap *heap, sty_run *run) {
+    int s = run->state - STY_RUN_DIRTY;
+    unsigned bin = sty_run_bin(run->bytes);
+    run->prev = NULL;
+    if ((run->next = heap->large_free[s][bin]) != NULL)
+        run->next->prev = run;
+    heap->large_free[s][bin] = run;
+    heap->large_bits[s][bin >> 6] |= (uint64_t)1 << (bin & 63);
+    if (run->state == STY_RUN_DIRTY)
+        atomic_fetch_add_explicit(&sty_dirty_bytes, run->bytes, memory_order_relaxed);
+}
+
+static void
+sty_run_pop(sty_heap *heap, sty_run *run) {
+    int s = run->state - STY_RUN_DIRTY;
+    unsigned bin = sty_run_bin(run->bytes);
+    if (run->prev != NULL)
+        run->prev->next = run->next;
+    else if ((heap->large_free[s][bin] = run->next) == NULL)
+        heap->large_bits[s][bin >> 6] &= ~((uint64_t)1 << (bin & 63));
+    if (run->next != NULL)
+        run->next->prev = run->prev;
+    if (run->state == STY_RUN_DIRTY)
+        atomic_fetch_sub_explicit(&sty_dirty_bytes, run->bytes, memory_order_relaxed);
+}
+
+/* addr处登记的run与run同属一个堆且同为空闲的state状态时返回它 */
+static sty_run *
+sty_run_buddy(sty_run *run, const char *addr) {
+    sty_run *buddy = sty_pagemap_get(addr);
+    if (buddy == NULL || buddy->heap != run->heap || buddy->state != run->state)
+        return NULL;
+    return buddy;
+}
+
+/**
+ * 把状态为dirty或clean的run与左右相邻的同状态空闲run合并后放回空闲链表，调用者必须持有
+ * heap->large_lock。run的首页与末页此时要么尚未登记，要么登记的就是run自己。
+ */
+static void
+sty_run_release(sty_heap *heap, sty_run *run) {
+    sty_run *buddy;
+    sty_run_unmap(run);
+    if ((buddy = sty_run_buddy(run, run->base - 1)) != NULL && buddy->base + buddy->bytes == run->base) {
+        sty_run_pop(heap, buddy);
+        sty_run_unmap(buddy);
+        run->base = buddy->base;
+        run->bytes += buddy->bytes;
+        run->stamp = run->stamp > buddy->stamp ? run->stamp : buddy->stamp;
+        run->nofork |= buddy->nofork;
+        sty_run_delete(heap, buddy);
+    }
+    if ((buddy = sty_run_buddy(run, run->base + run->bytes)) != NULL && buddy->base == run->base + run->bytes) {
+        sty_run_pop(heap, buddy);
+        sty_run_unmap(buddy);
+        run->bytes += buddy->bytes;
+        run->stamp = run->stamp > buddy->stamp ? run->stamp : buddy->stamp;
+        run->nofork |= buddy->nofork;
+        sty_run_delete(heap, buddy);
+    }
+    sty_run_map(run);
+    sty_run_push(heap, run);
+}
+
+/* 在state状态的空闲run中找一个不小于bytes的并摘出空闲链表 */
+static sty_run *
+sty_run_find(sty_heap *heap, int state, size_t bytes) {
+    int s = state - STY_RUN_DIRTY;
+    unsigned bin = sty_run_bin(bytes);
+    sty_run *run, *best = NULL;
+    /* 精确分档的档内大小都相同，其余的档内选最小的 */
+    for (run = heap->large_free[s][bin]; run != NULL; run = run->next) {
+        if (run->bytes >= bytes && (best == NULL || run->bytes < best->bytes)) {
+            best = run;
+            if (best->bytes == bytes)
+                break;
+        }
+    }
+    if (best == NULL && (bin = sty_run_next_bin(heap->large_bits[s], bin + 1)) < STY_RUN_BINS)
+        best = heap->large_free[s][bin];
+    if (best != NULL)
+        sty_run_pop(heap, best);
+    return best;
+}
+
+/* 以2 MiB为单位预留一块至少bytes字节的内存，作为一个clean的run并入空闲链表 */
+static int
+sty_large_grow(sty_heap *heap, size_t bytes) {
+    sty_run *run;
+    char *base;
+    int ok;
+    bytes = (bytes + STY_HUGE_2M - 1) & ~(STY_HUGE_2M - 1);
+    if ((run = sty_run_new(heap)) == NULL)
+        return 0;
+    if ((base = (char *)sty_os_map(bytes, STY_HUGE_2M)) == NULL || !sty_pagemap_reserve(base, bytes)) {
+        if (base != NULL)
+            sty_os_unmap(base, bytes);
+        sty_run_delete(heap, run);
+        return 0;
+    }
+    pthread_mutex_lock(&heap->pages_lock);
+    ok = sty_region_add(heap, base, bytes, 1);
+    pthread_mutex_unlock(&heap->pages_lock);
+    if (!ok) {
+        sty_os_unmap(base, bytes);
+        sty_run_delete(heap, run);
+        return 0;
+    }
+    sty_os_bind(base, bytes, heap->node);
+    sty_os_hugepage(base, bytes);
+    run->base = base;
+    run->bytes = bytes;
+    run->stamp = 0;
+    run->state = STY_RUN_CLEAN;
+    sty_run_release(heap, run);
+    return 1;
+}
+
+/**
+ * 从run的前端切下bytes字节，其余部分放回空闲链表；没有描述符可用时整个run都留给调用者。run已在
+ * 使用时，切下的尾部作为刚刚释放的dirty run放回。调用者必须已经注销run的首页和末页。
+ */
+static void
+sty_run_split(sty_heap *heap, sty_run *run, size_t bytes) {
+    sty_run *rest;
+    if (run->bytes == bytes || (rest = sty_run_new(heap)) == NULL)
+        return;
+    rest->base = run->base + bytes;
+    rest->bytes = run->bytes - bytes;
+    if (run->state == STY_RUN_USED) {
+        rest->stamp = sty_now_ms();
+        rest->state = STY_RUN_DIRTY;
+    } else {
+        rest->stamp = run->stamp;
+        rest->state = run->state;
+        rest->nofork = run->nofork;
+    }
+    run->bytes = bytes;
+    sty_run_release(heap, rest);
+}
+
+/**
+ * 从页堆中取一个bytes字节、起点按align对齐的run，调用者必须持有heap->large_lock。对齐要求超过一页
+ * 时多取align - sty_page_size字节，把对齐点之前的部分放回空闲链表。*zeroed返回run的内容是否必然
+ * 为零。
+ */
+static sty_run *
+sty_large_take(sty_heap *heap, size_t bytes, size_t align, int *zeroed) {
+    size_t slack = align > sty_page_size ? align - sty_page_size : 0;
+    sty_run *run, *head;
+    char *start;
+    if ((run = sty_run_find(heap, STY_RUN_DIRTY, bytes + slack)) == NULL
+        && (run = sty_run_find(heap, STY_RUN_CLEAN, bytes + slack)) == NULL) {
+        if (!sty_large_grow(heap, bytes + slack) || (run = sty_run_find(heap, STY_RUN_CLEAN, bytes + slack)) == NULL)
+            return NULL;
+    }
+    sty_run_unmap(run);
+    start = (char *)(((uintptr_t)run->base + align - 1) & ~(uintptr_t)(align - 1));
+    if (slack != 0 && start != run->base) {
+        if ((head = sty_run_new(heap)) == NULL) {
+            sty_run_release(heap, run);
+            return NULL;
+        }
+        head->base = run->base;
+        head->bytes = (size_t)(start - run->base);
+        head->stamp = run->stamp;
+        head->state = run->state;
+        head->nofork = run->nofork;
+        run->base = start;
+        run->bytes -= head->bytes;
+        sty_run_release(heap, head);
+    }
+    sty_run_split(heap, run, bytes);
+    if (run->nofork) {
+        sty_os_dofork(run->base, run->bytes);
+        run->nofork = 0;
+    }
+    *zeroed = run->state == STY_RUN_CLEAN && STY_MADV_PURGE == MADV_DONTNEED;
+    run->state = STY_RUN_USED;
+    run->sample = NULL;
+    sty_run_map(run);
+    ++heap->large_live;
+    return run;
+}
+
+/* 为超过sty_direct_min的对象单独映射一段内存 */
+static sty_run *
+sty_large_direct(sty_heap *heap, size_t bytes, size_t align) {
+    sty_run *run;
+    char *base;
+    if (align < sty_page_size)
+        align = sty_page_size;
+    /* 不小于大页的对象按大页对齐，使透明大页能够覆盖它 */
+    if (bytes >= STY_HUGE_2M && align < STY_HUGE_2M
+        && atomic_load_explicit(&sty_hugepage, memory_order_relaxed) != STY_HUGEPAGE_OFF)
+        align = STY_HUGE_2M;
+    if ((base = (char *)sty_os_map(bytes, align)) == NULL)
+        return NULL;
+    pthread_mutex_lock(&heap->large_lock);
+    if (!sty_pagemap_reserve(base, bytes) || (run = sty_run_new(heap)) == NULL) {
+        pthread_mutex_unlock(&heap->large_lock);
+        sty_os_unmap(base, bytes);
+        return NULL;
+    }
+    run->base = base;
+    run->bytes = bytes;
+    run->state = STY_RUN_DIRECT;
+    sty_run_map(run);
+    ++heap->large_live;
+    pthread_mutex_unlock(&heap->large_lock);
+    if (align == STY_HUGE_2M)
+        sty_os_hugepage(base, bytes);
+    sty_os_bind(base, bytes, heap->node);
+    return run;
+}
+
+/**
+ * 分配一个bytes字节、按align(可以为0)对齐的大对象。zero不为0时保证返回的内存全部为零：来自新映
+ * 射或已经用MADV_DONTNEED清除过的页本来就是零，只有复用dirty的run时才需要清零。
+ */
+static void *
+sty_large_alloc(sty_heap *heap, size_t bytes, size_t align, int zero) {
+    size_t total;
+    sty_run *run;
+    int zeroed = 1;
+    if (align < sty_page_size)
+        align = sty_page_size;
+    if (bytes > SIZE_MAX - align - STY_HUGE_2M)
+        return NULL;
+    total = bytes != 0 ? (bytes + sty_page_size - 1) & ~(sty_page_size - 1) : sty_page_size;
+    /* 由sty_heap_create创建的堆的全部内存都必须记录在它的regions中，所以不使用独占的映射 */
+    if (total + align - sty_page_size > atomic_load_explicit(&sty_direct_min, memory_order_relaxed)
+        && !heap->user) {
+        run = sty_large_direct(heap, total, align);
+    } else {
+        pthread_mutex_lock(&heap->large_lock);
+        run = sty_large_take(heap, total, align, &zeroed);
+        pthread_mutex_unlock(&heap->large_lock);
+    }
+    if (run == NULL)
+        return NULL;
+    atomic_fetch_add_explicit(&sty_active_bytes, run->bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sty_large_bytes, run->bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sty_large_count, 1, memory_order_relaxed);
+    sty_rss_check();
+    if (zero && !zeroed)
+        memset(run->base, 0, bytes);
+    return run->base;
+}
+
+static void sty_prof_free(sty_run *run);
+
+static void
+sty_large_free(sty_run *run) {
+    sty_heap *heap = run->heap;
+    char *base = run->base;
+    size_t bytes = run->bytes;
+    if (run->sample != NULL)
+        sty_prof_free(run);
+    atomic_fetch_sub_explicit(&sty_active_bytes, bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&sty_large_bytes, bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&sty_large_count, 1, memory_order_relaxed);
+    pthread_mutex_lock(&heap->large_lock);
+    --heap->large_live;
+    if (run->state == STY_RUN_DIRECT || run->state == STY_RUN_GUARD) {
+        /* 保护页紧跟在对象之后，一并解除映射 */
+        if (run->state == STY_RUN_GUARD)
+            bytes += sty_page_size;
+        /* 先注销再解除映射，否则这段地址可能已经被别处映射为小对象的span */
+        sty_run_unmap(run);
+        sty_run_delete(heap, run);
+        pthread_mutex_unlock(&heap->large_lock);
+        sty_os_unmap(base, bytes);
+        return;
+    }
+    run->state = STY_RUN_DIRTY;
+    run->stamp = sty_now_ms();
+    sty_run_release(heap, run);
+    pthread_mutex_unlock(&heap->large_lock);
+    sty_pages_decay(heap, atomic_load_explicit(&sty_decay_ms, memory_order_relaxed) == 0);
+    sty_rss_check();
+}
+
+/**
+ * 清除在deadline之前变为dirty的空闲run的物理页。这些run先被摘出空闲链表并标记为STY_RUN_BUSY，在
+ * 锁外调用madvise，完成后作为clean的run放回，期间不会被分配或合并。
+ */
+static void
+sty_large_decay(sty_heap *heap, uint64_t deadline) {
+    sty_run *list = NULL, *run, *next;
+    unsigned bin;
+    pthread_mutex_lock(&heap->large_lock);
+    for (bin = sty_run_next_bin(heap->large_bits[0], 0); bin < STY_RUN_BINS;
+         bin = sty_run_next_bin(heap->large_bits[0], bin + 1)) {
+        for (run = heap->large_free[0][bin]; run != NULL; run = next) {
+            next = run->next;
+            if (run->stamp > deadline)
+                continue;
+            sty_run_pop(heap, run);
+            run->state = STY_RUN_BUSY;
+            run->next = list;
+            list = run;
+        }
+    }
+    pthread_mutex_unlock(&heap->large_lock);
+    if (list == NULL)
+        return;
+    for (run = list; run != NULL; run = run->next) {
+        madvise(run->base, run->bytes, STY_MADV_PURGE);
+        run->nofork |= sty_os_dontfork(run->base, run->bytes);
+    }
+    pthread_mutex_lock(&heap->large_lock);
+    while ((run = list) != NULL) {
+        list = run->next;
+        run->state = STY_RUN_CLEAN;
+        sty_run_release(heap, run);
+    }
+    pthread_mutex_unlock(&heap->large_lock);
+}
+
+/* 把所有空闲的run解除映射；先注销页映射表，这样解除映射期间它们不会被合并 */
+static void
+sty_large_trim(sty_heap *heap) {
+    sty_run *list = NULL, *run;
+    unsigned bin;
+    int s, unmapped;
+    pthread_mutex_lock(&heap->large_lock);
+    for (s = 0; s < 2; ++s) {
+        while ((bin = sty_run_next_bin(heap->large_bits[s], 0)) < STY_RUN_BINS) {
+            run = heap->large_free[s][bin];
+            sty_run_pop(heap, run);
+            sty_run_unmap(run);
+            run->state = STY_RUN_BUSY;
+            run->next = list;
+            list = run;
+        }
+    }
+    pthread_mutex_unlock(&heap->large_lock);
+    while ((run = list) != NULL) {
+        list = run->next;
+        unmapped = sty_os_unmap(run->base, run->bytes) == 0;
+        pthread_mutex_lock(&heap->large_lock);
+        if (unmapped) {
+            sty_run_delete(heap, run);
+        } else {
+            /* 解除映射失败的run仍然可用 */
+            run->state = STY_RUN_DIRTY;
+            run->stamp = sty_now_ms();
+            sty_run_release(heap, run);
+        }
+        pthread_mutex_unlock(&heap->large_lock);
+    }
+}
+
+#ifndef STY_DEBUG
+/* 调试模式下sty_realloc总是搬移对象，用不到原地调整 */
+
+/**
+ * 把base处old字节的映射调整为bytes字节。扩张时先尝试原地扩张，否则预留一段新的地址空间并登记页
+ * 映射表的叶节点，再用mremap把原有的页表项整体搬过去，不复制任何数据。
+ */
+static char *
+sty_os_remap(char *base, size_t old, size_t bytes) {
+#ifdef __linux__
+    char *raw;
+    if (bytes <= old) {
+        if (bytes < old)
+            sty_os_unmap(base + bytes, old - bytes);
+        return base;
+    }
+    /* 原地扩展的尾部可能跨入尚无叶节点的区间，预留失败时只能搬到新的地址 */
+    if (sty_pagemap_reserve(base, bytes)) {
+        atomic_fetch_add_explicit(&sty_mmap_calls, 1, memory_order_relaxed);
+        if (mremap(base, old, bytes, 0) != MAP_FAILED) {
+            atomic_fetch_add_explicit(&sty_mapped_bytes, bytes - old, memory_order_relaxed);
+            return base;
+        }
+    }
+    atomic_fetch_add_explicit(&sty_mmap_calls, 2, memory_order_relaxed);
+    raw = (char *)mmap(NULL, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == (char *)MAP_FAILED)
+        return NULL;
+    atomic_fetch_add_explicit(&sty_mapped_bytes, bytes, memory_order_relaxed);
+    if (!sty_pagemap_reserve(raw, bytes) || mremap(base, old, bytes, MREMAP_MAYMOVE | MREMAP_FIXED, raw) == MAP_FAILED) {
+        sty_os_unmap(raw, bytes);
+        return NULL;
+    }
+    /* 原来的映射整体搬进了预留的地址空间 */
+    atomic_fetch_sub_explicit(&sty_mapped_bytes, old, memory_order_relaxed);
+    return raw;
+#else
+    (void)base;
+    (void)old;
+    (void)bytes;
+    return NULL;
+#endif
+}
+
+/**
+ * 原地调整大对象的大小，返回调整后的地址，无法原地调整时返回NULL，由调用者重新分配并复制。页堆中
+ * 的run缩小时把尾部放回空闲链表，扩张时吞并紧随其后的空闲run；独占映射的对象用mremap调整。
+ */
+static void *
+sty_large_resize(sty_run *run, size_t bytes) {
+    sty_heap *heap = run->heap;
+    size_t old = run->bytes, total;
+    sty_run *next;
+    char *base;
+    if (bytes > SIZE_MAX - STY_HUGE_2M)
+        return NULL;
+    total = (bytes + sty_page_size - 1) & ~(sty_page_size - 1);
+    if (run->state == STY_RUN_DIRECT) {
+        /* 搬移期间原来的地址可能被别处重新映射，所以先注销，失败时再恢复 */
+        pthread_mutex_lock(&heap->large_lock);
+        sty_run_unmap(run);
+        pthread_mutex_unlock(&heap->large_lock);
+        base = sty_os_remap(run->base, old, total);
+        pthread_mutex_lock(&heap->large_lock);
+        if (base != NULL) {
+            run->base = base;
+            run->bytes = total;
+        }
+        sty_run_map(run);
+        pthread_mutex_unlock(&heap->large_lock);
+    } else {
+        if (total > atomic_load_explicit(&sty_direct_min, memory_order_relaxed) && !heap->user)
+            return NULL;
+        base = run->base;
+        pthread_mutex_lock(&heap->large_lock);
+        if (total < old) {
+            sty_run_unmap(run);
+            sty_run_split(heap, run, total);
+            sty_run_map(run);
+        } else if (total > old) {
+            next = sty_pagemap_get(base + old);
+            if (next != NULL && next->heap == heap && next->base == base + old
+                && (next->state == STY_RUN_DIRTY || next->state == STY_RUN_CLEAN) && old + next->bytes >= total) {
+                sty_run_pop(heap, next);
+                sty_run_unmap(next);
+                sty_run_unmap(run);
+                if (next->nofork)
+                    sty_os_dofork(base + old, total - old);
+                run->bytes = total;
+                if (next->bytes > total - old) {
+                    next->bytes -= total - old;
+                    next->base += total - old;
+                    sty_run_release(heap, next);
+                } else {
+                    sty_run_delete(heap, next);
+                }
+                sty_run_map(run);
+            } else {
+                base = NULL;
+            }
+        }
+        pthread_mutex_unlock(&heap->large_lock);
+    }
+    if (base != NULL) {
+        atomic_fetch_add_explicit(&sty_active_bytes, run->bytes - old, memory_order_relaxed);
+        atomic_fetch_add_explicit(&sty_large_bytes, run->bytes - old, memory_order_relaxed);
+    }
+    return base;
+}
+#endif
+
+/**
+ * 分配轨迹记录。每个线程的记录先编码进自己的缓冲区，缓冲区满、线程退出或停止记录时才整块写入
+ * 文件。缓冲区由一个自旋锁保护，只有停止记录的线程会与其所有者竞争，所以几乎总是无竞争的。
+ */
+#define STY_TRACE_BUF       ((size_t)64 << 10)
+#define STY_TRACE_RECORD    48              /* 一条记录编码后的最大字节数 */
+#define STY_TRACE_DEAD      ((sty_trace_buf *)(uintptr_t)1)     /* 线程已经退出 */
+
+typedef struct sty_trace_buf {
+    _Atomic(int)        lock;
+    uint32_t            thread;         /* 线程编号，从1开始 */
+    uint64_t            gen;            /* 内容所属的那一次记录 */
+    uint64_t            base;           /* 本块首条记录的时刻 */
+    uint64_t            last;           /* 上一条记录的时刻 */
+    size_t              len;
+    unsigned char       data[];
+} sty_trace_buf;
+
+static _Atomic(int)         sty_tracing;
+static pthread_mutex_t      sty_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static int                  sty_trace_fd = -1;
+static int                  sty_trace_err;
+static uint64_t             sty_trace_gen;
+static uint64_t             sty_trace_t0;
+static _Atomic(uint32_t)    sty_trace_threads;
+
+static uint64_t
+sty_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned char *
+sty_varint(unsigned char *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    return p;
+}
+
+static int
+sty_write_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    ssize_t ret;
+    while (len > 0) {
+        if ((ret = write(fd, p, len)) > 0) {
+            p += ret;
+            len -= (size_t)ret;
+        } else if (ret < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 把缓冲区中的记录作为一个数据块写入文件，调用者必须持有buf->lock */
+static void
+sty_trace_flush(sty_trace_buf *buf) {
+    unsigned char head[32], *p;
+    if (buf->len == 0)
+        return;
+    p = sty_varint(head, buf->thread);
+    p = sty_varint(p, buf->base - sty_trace_t0);
+    p = sty_varint(p, buf->len);
+    pthread_mutex_lock(&sty_trace_lock);
+    if (buf->gen == sty_trace_gen && sty_trace_fd >= 0
+        && (sty_write_all(sty_trace_fd, head, (size_t)(p - head)) != 0
+            || sty_write_all(sty_trace_fd, buf->data, buf->len) != 0))
+        sty_trace_err = 1;
+    pthread_mutex_unlock(&sty_trace_lock);
+    buf->len = 0;
+}
+
+static void
+sty_trace_lock_buf(sty_trace_buf *buf) {
+    while (atomic_exchange_explicit(&buf->lock, 1, memory_order_acquire))
+        sched_yield();
+}
+
+static void
+sty_trace_unlock_buf(sty_trace_buf *buf) {
+    atomic_store_explicit(&buf->lock, 0, memory_order_release);
+}
+
+/* 记录一次事件；对于STY_TRACE_FREE只用到ptr，其余字段按类型取用 */
+static void
+sty_trace(unsigned type, const void *ptr, size_t bytes, size_t align, const void *old) {
+    sty_trace_buf *buf = sty_tc.trace;
+    unsigned char *p;
+    uint64_t now;
+    if (buf == STY_TRACE_DEAD)
+        return;
+    if (buf == NULL) {
+        sty_tcache_heap();      /* 停止记录时通过线程登记表找到这个缓冲区 */
+        if ((buf = (sty_trace_buf *)sty_os_map(STY_TRACE_BUF, sty_page_size)) == NULL)
+            return;
+        atomic_init(&buf->lock, 0);
+        buf->thread = atomic_fetch_add_explicit(&sty_trace_threads, 1, memory_order_relaxed) + 1;
+        buf->gen = 0;
+        buf->len = 0;
+        sty_tc.trace = buf;
+    }
+    sty_trace_lock_buf(buf);
+    if (!atomic_load_explicit(&sty_tracing, memory_order_acquire)) {
+        sty_trace_unlock_buf(buf);
+        return;
+    }
+    if (buf->gen != sty_trace_gen) {
+        buf->gen = sty_trace_gen;
+        buf->len = 0;
+    }
+    if (buf->len + STY_TRACE_RECORD > STY_TRACE_BUF - sizeof(sty_trace_buf))
+        sty_trace_flush(buf);
+    now = sty_now_ns();
+    if (buf->len == 0)
+        buf->base = buf->last = now;
+    p = buf->data + buf->len;
+    *p++ = (unsigned char)type;
+    p = sty_varint(p, now > buf->last ? now - buf->last : 0);
+    buf->last = now > buf->last ? now : buf->last;
+    if (type == STY_TRACE_REALLOC)
+        p = sty_varint(p, (uintptr_t)old >> 4);
+    else if (type == STY_TRACE_ALIGNED)
+        p = sty_varint(p, align);
+    if (type != STY_TRACE_FREE)
+        p = sty_varint(p, bytes);
+    p = sty_varint(p, (uintptr_t)ptr >> 4);
+    buf->len = (size_t)(p - buf->data);
+    sty_trace_unlock_buf(buf);
+}
+
+#define STY_TRACING()       atomic_load_explicit(&sty_tracing, memory_order_relaxed)
+
+static void
+sty_trace_exit(sty_tcache *tc) {
+    sty_trace_buf *buf = tc->trace;
+    tc->trace = STY_TRACE_DEAD;
+    if (buf == NULL || buf == STY_TRACE_DEAD)
+        return;
+    sty_trace_lock_buf(buf);
+    if (atomic_load_explicit(&sty_tracing, memory_order_acquire))
+        sty_trace_flush(buf);
+    sty_trace_unlock_buf(buf);
+    sty_os_unmap(buf, STY_TRACE_BUF);
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_trace_start(int fd) {
+    int ret = 0;
+    pthread_once(&sty_once, sty_init);
+    pthread_mutex_lock(&sty_trace_lock);
+    if (atomic_load_explicit(&sty_tracing, memory_order_relaxed)
+        || sty_write_all(fd, STY_TRACE_MAGIC, sizeof(STY_TRACE_MAGIC) - 1) != 0) {
+        ret = -1;
+    } else {
+        sty_trace_fd = fd;
+        sty_trace_err = 0;
+        ++sty_trace_gen;
+        sty_trace_t0 = sty_now_ns();
+        atomic_store_explicit(&sty_tracing, 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&sty_trace_lock);
+    return ret;
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_trace_stop(void) {
+    sty_tcache *tc;
+    int ret;
+    if (!atomic_exchange_explicit(&sty_tracing, 0, memory_order_acq_rel))
+        return -1;
+    /* 此后取得缓冲区锁的记录者都会看到sty_tracing为0，所以写出的就是全部记录 */
+    pthread_mutex_lock(&sty_threads_lock);
+    for (tc = sty_threads; tc != NULL; tc = tc->next) {
+        sty_trace_buf *buf = tc->trace;
+        if (buf == NULL || buf == STY_TRACE_DEAD)
+            continue;
+        sty_trace_lock_buf(buf);
+        sty_trace_flush(buf);
+        sty_trace_unlock_buf(buf);
+    }
+    pthread_mutex_unlock(&sty_threads_lock);
+    pthread_mutex_lock(&sty_trace_lock);
+    ret = sty_trace_err ? -1 : 0;
+    sty_trace_fd = -1;
+    pthread_mutex_unlock(&sty_trace_lock);
+    return ret;
+}
+
+/**
+ * 堆分析器。被采样的对象总是单独放在一个大对象run中，采样记录紧跟在对象之后，所有仍未释放的样本
+ * 通过run->next/prev串在sty_prof_live上。这样sty_free只需在大对象路径上多检查一次run->sample，
+ * 小对象的快路径不受任何影响。
+ */
+#define STY_PROF_DEPTH      64
+#define STY_PROF_FRAME_MAX  ((uintptr_t)1 << 20)    /* 相邻两个栈帧的最大距离 */
+#define STY_PROF_RECHECK    ((int64_t)1 << 26)      /* 停止采样时，每分配这么多字节检查一次 */
+
+typedef struct sty_sample {
+    size_t              bytes;          /* 请求的字节数 */
+    int                 depth;
+    void               *stack[STY_PROF_DEPTH];
+} sty_sample;
+
+static _Atomic(size_t)      sty_prof_rate;
+static _Atomic(int)         sty_prof_used;      /* 曾经开启过采样，存在被采样的对象 */
+static pthread_mutex_t      sty_prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static sty_run             *sty_prof_live;
+
+/* 服从均值为rate的指数分布的下一次采样间隔 */
+static int64_t
+sty_prof_next(size_t rate) {
+    uint64_t x = sty_tc.sample_seed;
+    double u;
+    if (x == 0)
+        x = (uint64_t)(uintptr_t)&sty_tc ^ (sty_now_ms() << 20) ^ 0x9E3779B97F4A7C15ull;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    sty_tc.sample_seed = x;
+    u = ((double)(x >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+    return (int64_t)(-log(u) * (double)rate) + 1;
+}
+
+static int
+sty_prof_backtrace(void **stack, int max) {
+#if defined(STY_PROFILE_LIBUNWIND)
+    return unw_backtrace(stack, max);
+#elif defined(__GNUC__)
+    /* 每个栈帧的开头依次保存着上一帧的帧指针和返回地址；帧指针不再单调增长时停止 */
+    void **fp = (void **)__builtin_frame_address(0), **next;
+    int depth = 0;
+    while (depth < max) {
+        stack[depth++] = fp[1];
+        next = (void **)fp[0];
+        if (next <= fp || (uintptr_t)next - (uintptr_t)fp > STY_PROF_FRAME_MAX
+            || ((uintptr_t)next & (sizeof(void *) - 1)) != 0)
+            break;
+        fp = next;
+    }
+    return depth;
+#else
+    (void)stack;
+    (void)max;
+    return 0;
+#endif
+}
+
+/**
+ * 本线程的采样计数耗尽时调用。需要采样时返回单独分配的对象，否则重置计数并返回NULL，由调用者
+ * 照常分配。
+ */
+static void *
+sty_prof_alloc(size_t bytes, size_t align, int zero) {
+    size_t rate = atomic_load_explicit(&sty_prof_rate, memory_order_relaxed);
+    size_t room = (bytes + 15) & ~(size_t)15;
+    sty_sample *sample;
+    sty_run *run;
+    char *obj;
+    if (rate == 0) {
+        sty_tc.sample_left = STY_PROF_RECHECK;
+        return NULL;
+    }
+    sty_tc.sample_left = sty_prof_next(rate);
+    if (bytes > SIZE_MAX - 15 - sizeof(sty_sample)
+        || (obj = (char *)sty_large_alloc(sty_tcache_heap(), room + sizeof(sty_sample), align, zero)) == NULL)
+        return NULL;
+    run = sty_pagemap_get(obj);
+    sample = (sty_sample *)(obj + room);
+    sample->bytes = bytes;
+    sample->depth = sty_prof_backtrace(sample->stack, STY_PROF_DEPTH);
+    run->sample = sample;
+    pthread_mutex_lock(&sty_prof_lock);
+    run->prev = NULL;
+    run->next = sty_prof_live;
+    if (sty_prof_live != NULL)
+        sty_prof_live->prev = run;
+    sty_prof_live = run;
+    pthread_mutex_unlock(&sty_prof_lock);
+    return obj;
+}
+
+static void
+sty_prof_free(sty_run *run) {
+    pthread_mutex_lock(&sty_prof_lock);
+    if (run->prev != NULL)
+        run->prev->next = run->next;
+    else
+        sty_prof_live = run->next;
+    if (run->next != NULL)
+        run->next->prev = run->prev;
+    pthread_mutex_unlock(&sty_prof_lock);
+}
+
+STY_API size_t STY_CDCEL STY_EXPORT
+sty_heap_profile_rate(size_t bytes) {
+    if (bytes != 0)
+        atomic_store_explicit(&sty_prof_used, 1, memory_order_relaxed);
+    return atomic_exchange_explicit(&sty_prof_rate, bytes, memory_order_relaxed);
+}
+
+/* 不经过堆内存的格式化输出，缓冲区满时写入fd */
+typedef struct sty_writer {
+    int                 fd;
+    int                 error;
+    size_t              len;
+    char                buf[4096];
+} sty_writer;
+
+static void
+sty_writer_flush(sty_writer *w) {
+    size_t done = 0;
+    ssize_t ret;
+    while (done < w->len && !w->error) {
+        if ((ret = write(w->fd, w->buf + done, w->len - done)) > 0)
+            done += (size_t)ret;
+        else if (ret < 0 && errno != EINTR)
+            w->error = 1;
+    }
+    w->len = 0;
+}
+
+static void
+sty_writer_str(sty_writer *w, const char *str, size_t len) {
+    size_t n;
+    while (len > 0) {
+        if (w->len == sizeof(w->buf))
+            sty_writer_flush(w);
+        n = sizeof(w->buf) - w->len < len ? sizeof(w->buf) - w->len : len;
+        memcpy(w->buf + w->len, str, n);
+        w->len += n;
+        str += n;
+        len -= n;
+    }
+}
+
+static void
+sty_writer_num(sty_writer *w, uint64_t value, unsigned base, int width) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    while (n < width && n < (int)sizeof(tmp))
+        tmp[sizeof(tmp) - 1 - n++] = ' ';
+    sty_writer_str(w, tmp + sizeof(tmp) - n, (size_t)n);
+}
+
+#define STY_WRITER_LIT(w, str)  sty_writer_str(w, str, sizeof(str) - 1)
+
+/* 形如"     1:   262144 [     1:   262144] @" */
+static void
+sty_writer_counts(sty_writer *w, uint64_t count, uint64_t bytes) {
+    sty_writer_num(w, count, 10, 6);
+    STY_WRITER_LIT(w, ": ");
+    sty_writer_num(w, bytes, 10, 8);
+    STY_WRITER_LIT(w, " [");
+    sty_writer_num(w, count, 10, 6);
+    STY_WRITER_LIT(w, ": ");
+    sty_writer_num(w, bytes, 10, 8);
+    STY_WRITER_LIT(w, "] @");
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_heap_profile_dump(int fd) {
+    sty_writer w;
+    sty_sample *sample;
+    sty_run *run;
+    uint64_t count = 0, bytes = 0;
+    ssize_t len;
+    int i, maps;
+    w.fd = fd;
+    w.error = 0;
+    w.len = 0;
+    pthread_mutex_lock(&sty_prof_lock);
+    for (run = sty_prof_live; run != NULL; run = run->next) {
+        ++count;
+        bytes += run->sample->bytes;
+    }
+    STY_WRITER_LIT(&w, "heap profile: ");
+    sty_writer_counts(&w, count, bytes);
+    STY_WRITER_LIT(&w, " heap_v2/");
+    sty_writer_num(&w, atomic_load_explicit(&sty_prof_rate, memory_order_relaxed), 10, 0);
+    STY_WRITER_LIT(&w, "\n");
+    for (run = sty_prof_live; run != NULL; run = run->next) {
+        sample = run->sample;
+        sty_writer_counts(&w, 1, sample->bytes);
+        for (i = 0; i < sample->depth; ++i) {
+            STY_WRITER_LIT(&w, " 0x");
+            sty_writer_num(&w, (uint64_t)(uintptr_t)sample->stack[i], 16, 0);
+        }
+        STY_WRITER_LIT(&w, "\n");
+    }
+    pthread_mutex_unlock(&sty_prof_lock);
+    STY_WRITER_LIT(&w, "\nMAPPED_LIBRARIES:\n");
+    if ((maps = open("/proc/self/maps", O_RDONLY | O_CLOEXEC)) >= 0) {
+        for (;;) {
+            if (w.len == sizeof(w.buf))
+                sty_writer_flush(&w);
+            if ((len = read(maps, w.buf + w.len, sizeof(w.buf) - w.len)) <= 0)
+                break;
+            w.len += (size_t)len;
+        }
+        close(maps);
+    }
+    sty_writer_flush(&w);
+    return w.error ? -1 : 0;
+}
+
+#ifdef STY_DEBUG
+/**
+ * 调试模式。每个对象在请求的字节之后多分配STY_REDZONE字节的红区：对象可用空间的最后8个字节记录
+ * 请求的字节数(与STY_DEBUG_LIVE异或)，两者之间填满STY_DEBUG_CANARY。释放时检查红区，发现越界写入、
+ * 重复释放或者不是由sty分配的指针时打印错误信息并结束进程。
+ * 被释放的小对象除开头的空闲链表指针之外填满STY_DEBUG_POISON，末尾记为STY_DEBUG_FREED；再次分配
+ * 时检查毒化的内容，被改写过说明有代码在释放之后仍然写入了它。
+ * sty_debug_guard开启后，sty_alloc一族分配的大对象各自独占一段映射，红区之后紧贴一个不可访问的
+ * 保护页，越过红区的访问立即触发SIGSEGV；释放时整段解除映射，释放后的访问同样触发SIGSEGV。
+ */
+#define STY_REDZONE         16
+#define STY_DEBUG_CANARY    0xab
+#define STY_DEBUG_POISON    0xdd
+#define STY_DEBUG_LIVE      UINT64_C(0x5354592d4c495645)
+#define STY_DEBUG_FREED     UINT64_C(0x5354592d46524545)
+
+static _Atomic(int)         sty_debug_guarded;
+
+/* 加上红区之后实际分配的字节数，溢出时返回SIZE_MAX使分配失败 */
+static size_t
+sty_debug_need(size_t bytes) {
+    return bytes < SIZE_MAX - STY_REDZONE ? bytes + STY_REDZONE : SIZE_MAX;
+}
+
+/* ptr所在对象可用空间的末尾，红区的最后8个字节紧贴在它之前 */
+static char *
+sty_debug_end(void *ptr, sty_run *run) {
+    if (run == NULL)
+        return (char *)ptr + sty_class_size[((sty_span *)((uintptr_t)ptr & STY_SPAN_MASK))->cls];
+    return run->sample != NULL ? (char *)run->sample : run->base + run->bytes;
+}
+
+/* 确认ptr是sty分配且尚未释放的对象，并且红区完好，返回请求的字节数 */
+static size_t
+sty_debug_check(void *ptr, sty_run *run) {
+    sty_span *span = (sty_span *)((uintptr_t)ptr & STY_SPAN_MASK);
+    unsigned char *p, *end;
+    uint64_t word;
+    size_t size;
+    if (run != NULL) {
+        if (run->state != STY_RUN_USED && run->state != STY_RUN_DIRECT && run->state != STY_RUN_GUARD)
+            sty_fatal("sty: double free of a large block\n");
+        if (run->state == STY_RUN_GUARD ? (size_t)((char *)ptr - run->base) >= sty_page_size : (char *)ptr != run->base)
+            sty_fatal("sty: pointer is not the start of a large block\n");
+    } else if (span->cls >= STY_NUM_CLASSES || (char *)ptr < (char *)span + sty_class_offset[span->cls]
+               || (char *)ptr >= span->limit
+               || (size_t)((char *)ptr - ((char *)span + sty_class_offset[span->cls])) % sty_class_size[span->cls] != 0) {
+        sty_fatal("sty: pointer is not the start of an object\n");
+    }
+    end = (unsigned char *)sty_debug_end(ptr, run);
+    memcpy(&word, end - 8, 8);
+    if (word == STY_DEBUG_FREED)
+        sty_fatal("sty: double free\n");
+    size = (size_t)(word ^ STY_DEBUG_LIVE);
+    if (size > (size_t)(end - (unsigned char *)ptr) - STY_REDZONE)
+        sty_fatal("sty: heap buffer overflow (redzone size word is corrupted)\n");
+    for (p = (unsigned char *)ptr + size; p < end - 8; ++p) {
+        if (*p != STY_DEBUG_CANARY)
+            sty_fatal("sty: heap buffer overflow (redzone is corrupted)\n");
+    }
+    return size;
+}
+
+/* 为刚分配的对象写入红区。对象是曾经释放过的小对象时，先确认毒化的内容没有被改写 */
+static void
+sty_debug_alloc(void *ptr, size_t size, int zero) {
+    sty_run *run = sty_pagemap_get(ptr);
+    unsigned char *p, *end = (unsigned char *)sty_debug_end(ptr, run);
+    uint64_t word;
+    memcpy(&word, end - 8, 8);
+    if (run == NULL && word == STY_DEBUG_FREED) {
+        for (p = (unsigned char *)ptr + 8; p < end - 8; ++p) {
+            if (*p != STY_DEBUG_POISON)
+                sty_fatal("sty: write after free\n");
+        }
+    }
+    /* 不暴露空闲链表中的指针 */
+    if (zero)
+        memset(ptr, 0, size);
+    else
+        memset(ptr, STY_DEBUG_POISON, size < 8 ? size : 8);
+    memset((unsigned char *)ptr + size, STY_DEBUG_CANARY, (size_t)(end - 8 - ((unsigned char *)ptr + size)));
+    word = (uint64_t)size ^ STY_DEBUG_LIVE;
+    memcpy(end - 8, &word, 8);
+}
+
+/* 释放之前检查对象，小对象随后被毒化；大对象的状态或映射本身就能发现重复释放 */
+static void
+sty_debug_free(void *ptr, sty_run *run) {
+    unsigned char *end;
+    uint64_t word = STY_DEBUG_FREED;
+    sty_debug_check(ptr, run);
+    if (run != NULL)
+        return;
+    end = (unsigned char *)sty_debug_end(ptr, run);
+    memset((unsigned char *)ptr + 8, STY_DEBUG_POISON, (size_t)(end - 8 - ((unsigned char *)ptr + 8)));
+    memcpy(end - 8, &word, 8);
+}
+
+/**
+ * 在保护页之前分配一个大对象：对象的末尾按align向下对齐后尽量贴近映射中最后一个可访问的字节。
+ * 对象的起点总在映射的第一页内，所以页映射表只需照常登记run的首页与末页。
+ */
+static void *
+sty_guard_alloc(size_t bytes, size_t align) {
+    sty_heap *heap = sty_tcache_heap();
+    size_t data;
+    sty_run *run;
+    char *base;
+    if (align < 16)
+        align = 16;
+    if (bytes > SIZE_MAX - 2 * sty_page_size)
+        return NULL;
+    data = (bytes + sty_page_size - 1) & ~(sty_page_size - 1);
+    if ((base = (char *)sty_os_map(data + sty_page_size, sty_page_size)) == NULL)
+        return NULL;
+    if (mprotect(base + data, sty_page_size, PROT_NONE) != 0) {
+        sty_os_unmap(base, data + sty_page_size);
+        return NULL;
+    }
+    pthread_mutex_lock(&heap->large_lock);
+    if (!sty_pagemap_reserve(base, data) || (run = sty_run_new(heap)) == NULL) {
+        pthread_mutex_unlock(&heap->large_lock);
+        sty_os_unmap(base, data + sty_page_size);
+        return NULL;
+    }
+    run->base = base;
+    run->bytes = data;
+    run->state = STY_RUN_GUARD;
+    sty_run_map(run);
+    ++heap->large_live;
+    pthread_mutex_unlock(&heap->large_lock);
+    atomic_fetch_add_explicit(&sty_active_bytes, data, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sty_large_bytes, data, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sty_large_count, 1, memory_order_relaxed);
+    sty_rss_check();
+    return (void *)((uintptr_t)(base + data - bytes) & ~(uintptr_t)(align - 1));
+}
+#endif
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_debug_guard(int enable) {
+#ifdef STY_DEBUG
+    if (enable < 0)
+        return atomic_load_explicit(&sty_debug_guarded, memory_order_relaxed);
+    return atomic_exchange_explicit(&sty_debug_guarded, enable != 0, memory_order_relaxed);
+#else
+    (void)enable;
+    return -1;
+#endif
+}
+
+/**
+ * align为不超过16的2的幂时按普通请求处理；否则从bytes对应的类别开始，选取第一个天然对齐满足
+ * 要求的类别，而不是多分配再填充。没有合适的类别时，把大对象的起点放在span内对齐的偏移上。
+ */
+static void *
+sty_do_alloc(size_t bytes, size_t align, int zero) {
+    unsigned cls;
+    void *obj;
+    if ((sty_tc.sample_left -= (int64_t)(bytes < STY_PROF_RECHECK ? bytes : STY_PROF_RECHECK)) < 0
+        && (obj = sty_prof_alloc(bytes, align, zero)) != NULL)
+        return obj;
+    if (bytes <= STY_SMALL_MAX) {
+        cls = sty_class_index[(bytes + 15) >> 4];
+        while (align > 16 && cls < STY_NUM_CLASSES && STY_CLASS_ALIGN(cls) < align)
+            ++cls;
+        if (cls < STY_NUM_CLASSES) {
+            obj = sty_small_alloc(cls);
+            if (zero && obj != NULL)
+                memset(obj, 0, bytes);
+            return obj;
+        }
+        bytes = STY_SMALL_MAX + 1;
+    }
+#ifdef STY_DEBUG
+    if (atomic_load_explicit(&sty_debug_guarded, memory_order_relaxed) && align <= sty_page_size
+        && (obj = sty_guard_alloc(bytes, align)) != NULL)
+        return obj;
+#endif
+    return sty_large_alloc(sty_tcache_heap(), bytes, align, zero);
+}
+
+static void *
+sty_alloc_loop(size_t bytes, size_t align, int zero) {
+    void *ptr;
+    int i;
+#ifdef STY_DEBUG
+    size_t size = bytes;
+    int clear = zero;
+    bytes = sty_debug_need(bytes);
+    zero = 0;               /* 先检查毒化的内容，再由sty_debug_alloc清零 */
+#endif
+    for (i = 0; (ptr = sty_do_alloc(bytes, align, zero)) == NULL; ++i) {
+        if (!sty_oom(bytes, i))
+            return NULL;
+    }
+#ifdef STY_DEBUG
+    sty_debug_alloc(ptr, size, clear);
+#endif
+    return ptr;
+}
+
+static void *
+sty_alloc_try(size_t bytes, size_t align, int zero) {
+    void *ptr = sty_alloc_loop(bytes, align, zero);
+    if (STY_TRACING() && ptr != NULL)
+        sty_trace(align > 16 ? STY_TRACE_ALIGNED : zero ? STY_TRACE_CALLOC : STY_TRACE_ALLOC, ptr, bytes, align, NULL);
+    return ptr;
+}
+
+static void *
+sty_alloc_retry(size_t bytes, size_t align, int zero) {
+    void *ptr = sty_alloc_try(bytes, align, zero);
+    if (ptr == NULL)
+        exit(STY_ALLOC_OOM);
+    return ptr;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_alloc(size_t bytes) {
+    return sty_alloc_retry(bytes, 0, 0);
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_try_alloc(size_t bytes) {
+    return sty_alloc_try(bytes, 0, 0);
+}
+
+STY_API sty_oom_handler_t STY_CDCEL STY_EXPORT
+sty_set_oom_handler(sty_oom_handler_t handler) {
+    return atomic_exchange_explicit(&sty_oom_fn, handler, memory_order_acq_rel);
+}
+
+/* 不是2的幂的对齐要求被向上取整为2的幂，无法取整时返回0 */
+static int
+sty_align_pow2(size_t *align) {
+    if (*align > ((size_t)1 << (sizeof(size_t) * 8 - 1)))
+        return 0;
+    while (*align & (*align - 1))
+        *align = (*align | (*align - 1)) + 1;
+    return 1;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_alloc_aligned(size_t align, size_t bytes) {
+    if (!sty_align_pow2(&align))
+        exit(STY_ALLOC_OOM);
+    return sty_alloc_retry(bytes, align, 0);
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_try_alloc_aligned(size_t align, size_t bytes) {
+    if (!sty_align_pow2(&align))
+        return NULL;
+    return sty_alloc_try(bytes, align, 0);
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_calloc(size_t count, size_t bytes) {
+    if (bytes != 0 && count > SIZE_MAX / bytes)
+        exit(STY_ALLOC_OOM);
+    return sty_alloc_retry(count * bytes, 0, 1);
+}
+
+static void
+sty_do_free(void *ptr) {
+    sty_run *run = sty_pagemap_get(ptr);
+    sty_span *span;
+#ifdef STY_DEBUG
+    sty_debug_free(ptr, run);
+#endif
+    if (run != NULL) {
+        sty_large_free(run);
+        return;
+    }
+    span = (sty_span *)((uintptr_t)ptr & STY_SPAN_MASK);
+    if (span->heap == sty_tc.heap)
+        sty_small_free(span->cls, ptr);
+    else
+        sty_small_free_foreign(span, ptr);
+}
+
+static void *sty_heap_loop(sty_heap *heap, size_t bytes);
+
+/* ptr实际可用的字节数：小对象是所属类别的大小，大对象是按页取整后的大小 */
+static size_t
+sty_usable(void *ptr) {
+    sty_run *run = sty_pagemap_get(ptr);
+#ifdef STY_DEBUG
+    /* 红区不属于调用者 */
+    return sty_debug_check(ptr, run);
+#endif
+    if (run != NULL)
+        return run->sample != NULL ? (size_t)((char *)run->sample - (char *)ptr) : run->bytes;
+    return sty_class_size[((sty_span *)((uintptr_t)ptr & STY_SPAN_MASK))->cls];
+}
+
+/* must为0时，分配失败返回NULL而ptr保持不变 */
+static void *
+sty_do_realloc(void *ptr, size_t bytes, int must) {
+    sty_heap *heap;
+    sty_span *span;
+    sty_run *run;
+    size_t usable;
+    void *result;
+    if (ptr == NULL)
+        return must ? sty_alloc_retry(bytes, 0, 0) : sty_alloc_try(bytes, 0, 0);
+#ifdef STY_DEBUG
+    /* 调试模式下总是搬移对象，仍在使用旧指针的代码会被毒化检查或保护页发现 */
+    run = sty_pagemap_get(ptr);
+    usable = sty_debug_check(ptr, run);
+    heap = run != NULL ? run->heap : ((sty_span *)((uintptr_t)ptr & STY_SPAN_MASK))->heap;
+    (void)span;
+#else
+    if ((run = sty_pagemap_get(ptr)) == NULL) {
+        /* 只有仍落在原尺寸类别内时才原地返回，否则之后按bytes调用sty_free_sized会放错类别 */
+        span = (sty_span *)((uintptr_t)ptr & STY_SPAN_MASK);
+        heap = span->heap;
+        usable = sty_class_size[span->cls];
+        if (bytes <= usable && sty_class_index[(bytes + 15) >> 4] == span->cls) {
+            if (STY_TRACING())
+                sty_trace(STY_TRACE_REALLOC, ptr, bytes, 0, ptr);
+            return ptr;
+        }
+    } else {
+        heap = run->heap;
+        usable = run->sample != NULL ? (size_t)((char *)run->sample - (char *)ptr) : run->bytes;
+        /* 被采样的对象保持原来的采样记录，改为重新分配 */
+        if (bytes > STY_SMALL_MAX && run->sample == NULL && (result = sty_large_resize(run, bytes)) != NULL) {
+            if (STY_TRACING())
+                sty_trace(STY_TRACE_REALLOC, result, bytes, 0, ptr);
+            return result;
+        }
+    }
+#endif
+    /* 由sty_heap_create创建的堆中的对象搬移后仍然留在原来的堆中 */
+    if ((result = heap->user ? sty_heap_loop(heap, bytes) : sty_alloc_loop(bytes, 0, 0)) == NULL) {
+        if (must)
+            exit(STY_ALLOC_OOM);
+        return NULL;
+    }
+    if (STY_TRACING())
+        sty_trace(STY_TRACE_REALLOC, result, bytes, 0, ptr);
+    memcpy(result, ptr, bytes < usable ? bytes : usable);
+    sty_do_free(ptr);
+    return result;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_realloc(void *ptr, size_t bytes) {
+    return sty_do_realloc(ptr, bytes, 1);
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_alloc_at_least(size_t bytes, size_t *actual) {
+    void *ptr = sty_alloc_retry(bytes, 0, 0);
+    if (actual != NULL)
+        *actual = sty_usable(ptr);
+    return ptr;
+}
+
+STY_API size_t STY_CDCEL STY_EXPORT
+sty_usable_size(const void *ptr) {
+    return ptr != NULL ? sty_usable((void *)ptr) : 0;
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_free(void *ptr) {
+    if (ptr == NULL)
+        return;
+    if (STY_TRACING())
+        sty_trace(STY_TRACE_FREE, ptr, 0, 0, NULL);
+    sty_do_free(ptr);
+}
+
+#ifdef STY_DEBUG
+static void
+sty_fatal(const char *msg) {
+    ssize_t ret = write(STDERR_FILENO, msg, strlen(msg));
+    (void)ret;
+    abort();
+}
+
+/* 红区中记录着请求的字节数，bytes不能超过它，也不能落在另一个尺寸类别中 */
+static void
+sty_check_size(void *ptr, size_t bytes) {
+    size_t size = sty_debug_check(ptr, sty_pagemap_get(ptr));
+    if (bytes > size)
+        sty_fatal("sty_free_sized: size is larger than the block\n");
+    if (size <= STY_SMALL_MAX && sty_class_index[(bytes + 15) >> 4] != sty_class_index[(size + 15) >> 4])
+        sty_fatal("sty_free_sized: size does not match the size class of the block\n");
+}
+#endif
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_free_sized(void *ptr, size_t bytes) {
+    if (ptr == NULL)
+        return;
+#ifdef STY_DEBUG
+    sty_check_size(ptr, bytes);
+#endif
+    /* 被采样的小对象实际上是大对象，不能按大小直接放回空闲链表 */
+    if (STY_TRACING())
+        sty_trace(STY_TRACE_FREE, ptr, 0, 0, NULL);
+#ifdef STY_DEBUG
+    sty_do_free(ptr);
+#else
+    /* 尚未登记的线程由sty_do_free登记，否则线程退出时不会清空它的缓存；析构之后的线程不能缓存 */
+    if (bytes > STY_SMALL_MAX || (uintptr_t)sty_tc.heap <= (uintptr_t)STY_TCACHE_DEAD || sty_multi_heap
+        || atomic_load_explicit(&sty_prof_used, memory_order_relaxed))
+        sty_do_free(ptr);
+    else
+        sty_small_free(sty_class_index[(bytes + 15) >> 4], ptr);
+#endif
+}
+
+/**
+ * 快路径只比sty_small_alloc多一次采样计数的检查；需要采样、正在记录轨迹或线程缓存取不到对象时，
+ * 交还计数并按普通请求处理。
+ */
+STY_API void * STY_CDCEL STY_EXPORT
+sty_alloc_class(unsigned cls) {
+    size_t bytes;
+    void *obj;
+#ifdef STY_DEBUG
+    if (cls >= STY_NUM_CLASSES)
+        sty_fatal("sty_alloc_class: size class out of range\n");
+    /* 加上红区后对象落在更大的类别中，只能按普通请求分配 */
+    return sty_alloc_retry(sty_class_size[cls], 0, 0);
+#endif
+    bytes = sty_class_size[cls];
+    if ((sty_tc.sample_left -= (int64_t)bytes) >= 0 && !STY_TRACING() && (obj = sty_small_alloc(cls)) != NULL)
+        return obj;
+    sty_tc.sample_left += (int64_t)bytes;
+    return sty_alloc_retry(bytes, 0, 0);
+}
+
+/**
+ * 批量分配：先整段取走线程缓存中的对象，不足的部分在一次加锁中直接从中心池取得，不经过线程缓存
+ * 周转。
+ */
+STY_API void STY_CDCEL STY_EXPORT
+sty_alloc_bulk(size_t bytes, size_t count, void **out) {
+    sty_heap *heap;
+    sty_bin *bin;
+    unsigned cls;
+    uint32_t got, n;
+    void *list;
+    size_t i = 0;
+    int attempt = 0;
+#ifdef STY_DEBUG
+    /* 每个对象都要经过sty_alloc写入红区，不能直接从中心池取得 */
+    for (; i < count; ++i)
+        out[i] = sty_alloc(bytes);
+    return;
+#endif
+    if (bytes > STY_SMALL_MAX) {
+        for (; i < count; ++i)
+            out[i] = sty_alloc(bytes);
+        return;
+    }
+    heap = sty_tcache_heap();
+    cls = sty_class_index[(bytes + 15) >> 4];
+    bin = &sty_tc.bins[cls];
+    for (list = bin->head; i < count && list != NULL; list = *(void **)list)
+        out[i++] = list;
+    bin->head = list;
+    bin->count -= (uint32_t)i;
+    bin->allocs += count;
+    while (i < count) {
+        n = count - i < UINT32_MAX ? (uint32_t)(count - i) : UINT32_MAX;
+        if ((got = sty_central_fetch(heap, cls, n, &list)) == 0) {
+            if (!sty_oom(bytes, attempt++))
+                exit(STY_ALLOC_OOM);
+            continue;
+        }
+        for (; list != NULL; list = *(void **)list)
+            out[i++] = list;
+    }
+    if (sty_tc.heap == STY_TCACHE_DEAD)
+        sty_tcache_dead_retire();
+    if (STY_TRACING())
+        for (i = 0; i < count; ++i)
+            sty_trace(STY_TRACE_ALLOC, out[i], bytes, 0, NULL);
+}
+
+/**
+ * 批量释放：属于本线程堆的小对象逐个链入线程缓存，超出容量的部分最后一次性还给中心池，而不是在
+ * 每次溢出时分批归还。
+ */
+STY_API void STY_CDCEL STY_EXPORT
+sty_free_bulk(void **ptrs, size_t count) {
+    sty_heap *heap = sty_tcache_heap();
+    uint32_t over = 0;
+    sty_span *span;
+    sty_bin *bin;
+    unsigned cls;
+    size_t i;
+#ifdef STY_DEBUG
+    /* 每个对象都要经过sty_free检查红区并毒化 */
+    for (i = 0; i < count; ++i)
+        sty_free(ptrs[i]);
+    return;
+#endif
+    /* 析构之后的线程不能缓存对象，没有span属于NULL，于是全部交给sty_free */
+    if (sty_tc.heap == STY_TCACHE_DEAD)
+        heap = NULL;
+    for (i = 0; i < count; ++i) {
+        if (ptrs[i] == NULL)
+            continue;
+        span = (sty_span *)((uintptr_t)ptrs[i] & STY_SPAN_MASK);
+        if (sty_pagemap_get(ptrs[i]) != NULL || span->heap != heap) {
+            sty_free(ptrs[i]);
+            continue;
+        }
+        if (STY_TRACING())
+            sty_trace(STY_TRACE_FREE, ptrs[i], 0, 0, NULL);
+        bin = &sty_tc.bins[span->cls];
+        *(void **)ptrs[i] = bin->head;
+        bin->head = ptrs[i];
+        ++bin->frees;
+        if (++bin->count > sty_class_cache[span->cls])
+            over |= 1u << span->cls;
+    }
+    for (cls = 0; over != 0; ++cls, over >>= 1) {
+        bin = &sty_tc.bins[cls];
+        if ((over & 1) && bin->count > sty_class_cache[cls])
+            sty_tcache_trim(bin, sty_class_batch[cls]);
+    }
+}
+
+/**
+ * 区域分配器。区域以STY_SPAN_SIZE大小的内存块为单位直接从页源取得内存，区域本身的元数据放在
+ * 第一个内存块的首部。超过STY_ARENA_BIG的单个请求经由sty_alloc独占一段内存。
+ */
+#define STY_ARENA_BIG       (STY_SPAN_SIZE / 4)
+
+typedef struct sty_chunk {
+    struct sty_chunk   *next;
+    void               *pad;
+} sty_chunk;
+
+struct sty_arena {
+    sty_heap           *heap;           /* 内存块来自这个堆的页源 */
+    char               *cur;            /* 当前内存块中下一次分配的起点 */
+    char               *end;            /* 当前内存块的终点 */
+    sty_chunk          *chunks;         /* 除第一块之外正在使用的内存块，最新的在前 */
+    sty_chunk          *tail;           /* chunks中最早取得的一块 */
+    sty_chunk          *spare;          /* 重置后留待复用的内存块 */
+    sty_chunk          *big;            /* 超大请求独占的内存 */
+};
+
+#define STY_ARENA_FIRST     ((sizeof(struct sty_arena) + 15) & ~(size_t)15)
+
+static sty_span *
+sty_pages_span_retry(sty_heap *heap) {
+    sty_span *span;
+    int i;
+    for (i = 0; (span = sty_pages_span(heap)) == NULL; ++i) {
+        if (!sty_oom(STY_SPAN_SIZE, i))
+            exit(STY_ALLOC_OOM);
+    }
+    return span;
+}
+
+STY_API sty_arena_t * STY_CDCEL STY_EXPORT
+sty_arena_create(void) {
+    sty_heap *heap = sty_tcache_heap();
+    struct sty_arena *arena = (struct sty_arena *)sty_pages_span_retry(heap);
+    arena->heap = heap;
+    arena->cur = (char *)arena + STY_ARENA_FIRST;
+    arena->end = (char *)arena + STY_SPAN_SIZE;
+    arena->chunks = arena->tail = NULL;
+    arena->spare = NULL;
+    arena->big = NULL;
+    return arena;
+}
+
+static void *
+sty_arena_grow(struct sty_arena *arena, size_t bytes) {
+    sty_chunk *chunk;
+    if (bytes > STY_ARENA_BIG) {
+        if (bytes > SIZE_MAX - sizeof(sty_chunk))
+            exit(STY_ALLOC_OOM);
+        chunk = (sty_chunk *)sty_alloc(sizeof(sty_chunk) + bytes);
+        chunk->next = arena->big;
+        arena->big = chunk;
+        return chunk + 1;
+    }
+    if ((chunk = arena->spare) != NULL)
+        arena->spare = chunk->next;
+    else
+        chunk = (sty_chunk *)sty_pages_span_retry(arena->heap);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    if (arena->tail == NULL)
+        arena->tail = chunk;
+    arena->cur = (char *)(chunk + 1) + bytes;
+    arena->end = (char *)chunk + STY_SPAN_SIZE;
+    return chunk + 1;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_arena_alloc(sty_arena_t *arena, size_t bytes) {
+    char *ptr = arena->cur;
+    /* 0字节按16字节分配，保证每次返回不同的地址；取整溢出时need为0，need - 1最大，交给慢路径处理 */
+    size_t need = ((bytes + 15) & ~(size_t)15) | (size_t)(bytes == 0) << 4;
+    if (need - 1 < (size_t)(arena->end - ptr)) {
+        arena->cur = ptr + need;
+        return ptr;
+    }
+    if (need == 0)
+        exit(STY_ALLOC_OOM);
+    return sty_arena_grow(arena, need);
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_arena_reset(sty_arena_t *arena) {
+    sty_chunk *chunk;
+    /* 普通内存块整串挂到复用链表上，不逐块遍历 */
+    if (arena->chunks != NULL) {
+        arena->tail->next = arena->spare;
+        arena->spare = arena->chunks;
+        arena->chunks = arena->tail = NULL;
+    }
+    while ((chunk = arena->big) != NULL) {
+        arena->big = chunk->next;
+        sty_free(chunk);
+    }
+    arena->cur = (char *)arena + STY_ARENA_FIRST;
+    arena->end = (char *)arena + STY_SPAN_SIZE;
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_arena_destroy(sty_arena_t *arena) {
+    sty_chunk *chunk;
+    if (arena == NULL)
+        return;
+    sty_arena_reset(arena);
+    while ((chunk = arena->spare) != NULL) {
+        arena->spare = chunk->next;
+        sty_pages_release(arena->heap, (sty_span *)chunk);
+    }
+    sty_pages_release(arena->heap, (sty_span *)arena);
+}
+
+/**
+ * 固定大小对象的对象池。对象池从页源取得slab，slab首部串成链表以便销毁。对象池的描述符从不
+ * 释放，销毁后只把编号清零并留待复用，这样其他线程手中残留的缓存项总能安全地判断对象池是否
+ * 仍然存活。
+ */
+#define STY_POOL_SLAB_MIN   16              /* slab至少容纳的对象个数的默认值 */
+
+typedef struct sty_slab {
+    struct sty_slab    *next;
+    size_t              bytes;          /* 来自页源时为0，否则来自sty_alloc */
+} sty_slab;
+
+struct sty_pool {
+    pthread_mutex_t     lock;
+    sty_heap           *heap;           /* slab来自这个堆的页源 */
+    _Atomic(uint64_t)   id;
+    size_t              size;
+    int                 flags;
+    uint32_t            batch;
+    size_t              slab_min;       /* 创建时的sty_pool_slab_min */
+    void               *free;           /* 池中的空闲对象 */
+    char               *bump;           /* 当前slab中尚未切分的区域 */
+    char               *limit;
+    sty_slab           *slabs;
+    struct sty_pool    *next;           /* 已销毁、待复用的描述符 */
+    struct sty_pool    *all;            /* 所有描述符，由sty_pools_lock保护，fork时用来锁住每个对象池 */
+};
+
+static pthread_mutex_t      sty_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sty_pool     *sty_pools_unused;
+static struct sty_pool     *sty_pools_all;
+static _Atomic(size_t)      sty_pool_slab_min = STY_POOL_SLAB_MIN;
+static uint64_t             sty_pools_id;
+
+STY_API sty_pool_t * STY_CDCEL STY_EXPORT
+sty_pool_create(size_t bytes, int flags) {
+    struct sty_pool *pool;
+    size_t slab_min = atomic_load_explicit(&sty_pool_slab_min, memory_order_relaxed);
+    uint64_t id;
+    bytes = bytes > 16 ? (bytes + 15) & ~(size_t)15 : 16;
+    if (bytes == 0 || bytes > (SIZE_MAX - sizeof(sty_slab)) / slab_min)
+        exit(STY_ALLOC_OOM);
+    pthread_mutex_lock(&sty_pools_lock);
+    if ((pool = sty_pools_unused) != NULL)
+        sty_pools_unused = pool->next;
+    id = ++sty_pools_id;
+    pthread_mutex_unlock(&sty_pools_lock);
+    if (pool == NULL) {
+        pool = (struct sty_pool *)sty_alloc(sizeof(struct sty_pool));
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_mutex_lock(&sty_pools_lock);
+        pool->all = sty_pools_all;
+        sty_pools_all = pool;
+        pthread_mutex_unlock(&sty_pools_lock);
+    }
+    pool->heap = sty_tcache_heap();
+    pthread_mutex_lock(&pool->lock);
+    pool->size = bytes;
+    pool->flags = flags;
+    pool->batch = (uint32_t)(bytes < sty_batch_bytes / STY_BATCH_MAX ? STY_BATCH_MAX
+                           : bytes > sty_batch_bytes / STY_BATCH_MIN ? STY_BATCH_MIN
+                           : sty_batch_bytes / bytes);
+    pool->slab_min = slab_min;
+    pool->free = NULL;
+    pool->bump = pool->limit = NULL;
+    pool->slabs = NULL;
+    pool->next = NULL;
+    atomic_store_explicit(&pool->id, id, memory_order_release);
+    pthread_mutex_unlock(&pool->lock);
+    return pool;
+}
+
+/* 调用者必须持有pool->lock */
+static void *
+sty_pool_take(struct sty_pool *pool) {
+    sty_slab *slab;
+    size_t bytes;
+    void *obj;
+    if ((obj = pool->free) != NULL) {
+        pool->free = *(void **)obj;
+        return obj;
+    }
+    if ((size_t)(pool->limit - pool->bump) < pool->size) {
+        if (pool->size * pool->slab_min <= STY_SPAN_SIZE - sizeof(sty_slab)) {
+            slab = (sty_slab *)sty_pages_span_retry(pool->heap);
+            slab->bytes = 0;
+            bytes = STY_SPAN_SIZE;
+        } else {
+            bytes = sizeof(sty_slab) + pool->size * pool->slab_min;
+            slab = (sty_slab *)sty_alloc(bytes);
+            slab->bytes = bytes;
+        }
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->bump = (char *)(slab + 1);
+        pool->limit = (char *)slab + bytes;
+    }
+    obj = pool->bump;
+    pool->bump += pool->size;
+    return obj;
+}
+
+/* 把缓存项中的对象还给所属的对象池；对象池已被销毁时，这些对象随其slab一起失效 */
+static void
+sty_pool_evict(sty_pool_bin *bin) {
+    struct sty_pool *pool = bin->pool;
+    void *obj;
+    if (bin->id != 0 && atomic_load_explicit(&pool->id, memory_order_acquire) == bin->id) {
+        pthread_mutex_lock(&pool->lock);
+        /* 销毁与复用描述符都在持有锁时修改编号，加锁之前的检查可能已经过时 */
+        if (atomic_load_explicit(&pool->id, memory_order_relaxed) == bin->id) {
+            while ((obj = bin->head) != NULL) {
+                bin->head = *(void **)obj;
+                *(void **)obj = pool->free;
+                pool->free = obj;
+            }
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    bin->pool = NULL;
+    bin->id = 0;
+    bin->head = NULL;
+    bin->count = 0;
+}
+
+static sty_pool_bin *
+sty_pool_bin_of(struct sty_pool *pool, uint64_t id) {
+    sty_pool_bin *bin = &sty_tc.pools[id % STY_POOL_TCACHE];
+    if (bin->id != id) {
+        sty_pool_evict(bin);
+        bin->pool = pool;
+        bin->id = id;
+    }
+    return bin;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_pool_alloc(sty_pool_t *pool) {
+    sty_pool_bin *bin;
+    uint64_t id;
+    uint32_t i;
+    void *obj;
+    /* 线程退出时才会把缓存项还给对象池；补充slab时可能调用sty_alloc，线程还必须在加锁之前登记，否则与fork时的加锁顺序相反 */
+    sty_tcache_heap();
+    /* 析构之后的线程缓存的对象会随线程一起丢失，直接使用对象池 */
+    if ((pool->flags & STY_POOL_THREAD_CACHE) && sty_tc.heap != STY_TCACHE_DEAD) {
+        id = atomic_load_explicit(&pool->id, memory_order_relaxed);
+        bin = sty_pool_bin_of(pool, id);
+        if ((obj = bin->head) != NULL) {
+            bin->head = *(void **)obj;
+            --bin->count;
+            return obj;
+        }
+        pthread_mutex_lock(&pool->lock);
+        for (i = 1; i < pool->batch; ++i) {
+            obj = sty_pool_take(pool);
+            *(void **)obj = bin->head;
+            bin->head = obj;
+        }
+        bin->count = pool->batch - 1;
+        obj = sty_pool_take(pool);
+        pthread_mutex_unlock(&pool->lock);
+        return obj;
+    }
+    pthread_mutex_lock(&pool->lock);
+    obj = sty_pool_take(pool);
+    pthread_mutex_unlock(&pool->lock);
+    return obj;
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_pool_free(sty_pool_t *pool, void *obj) {
+    sty_pool_bin *bin;
+    void *list, *last;
+    uint32_t i;
+    if (obj == NULL)
+        return;
+    sty_tcache_heap();      /* 线程退出时才会把缓存项还给对象池 */
+    if ((pool->flags & STY_POOL_THREAD_CACHE) && sty_tc.heap != STY_TCACHE_DEAD) {
+        bin = sty_pool_bin_of(pool, atomic_load_explicit(&pool->id, memory_order_relaxed));
+        *(void **)obj = bin->head;
+        bin->head = obj;
+        if (++bin->count <= pool->batch * 2)
+            return;
+        /* 保留最近释放的一批，把其余的一次性还给对象池 */
+        last = bin->head;
+        for (i = 1; i < pool->batch; ++i)
+            last = *(void **)last;
+        list = *(void **)last;
+        *(void **)last = NULL;
+        bin->count = pool->batch;
+        for (last = list; *(void **)last != NULL; last = *(void **)last)
+            ;
+        pthread_mutex_lock(&pool->lock);
+        *(void **)last = pool->free;
+        pool->free = list;
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    *(void **)obj = pool->free;
+    pool->free = obj;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_pool_destroy(sty_pool_t *pool) {
+    sty_pool_bin *bin;
+    sty_slab *slab;
+    uint64_t id;
+    if (pool == NULL)
+        return;
+    /* 本线程的缓存项可以直接清空，其他线程的缓存项会在下次被替换时发现编号已经失效 */
+    id = atomic_load_explicit(&pool->id, memory_order_relaxed);
+    bin = &sty_tc.pools[id % STY_POOL_TCACHE];
+    if (bin->id == id) {
+        bin->pool = NULL;
+        bin->id = 0;
+        bin->head = NULL;
+        bin->count = 0;
+    }
+    /* 其他线程的sty_pool_evict在锁内确认编号，清零之后不会再把对象放回这个对象池 */
+    pthread_mutex_lock(&pool->lock);
+    atomic_store_explicit(&pool->id, 0, memory_order_release);
+    while ((slab = pool->slabs) != NULL) {
+        pool->slabs = slab->next;
+        if (slab->bytes == 0)
+            sty_pages_release(pool->heap, (sty_span *)slab);
+        else
+            sty_free(slab);
+    }
+    pool->free = NULL;
+    pool->bump = pool->limit = NULL;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_lock(&sty_pools_lock);
+    pool->next = sty_pools_unused;
+    sty_pools_unused = pool;
+    pthread_mutex_unlock(&sty_pools_lock);
+}
+
+/**
+ * 由sty_heap_create创建的独立的堆。它与按NUMA节点划分的堆使用同一套中心池、页源与页堆，只是
+ * 不绑定到任何线程：sty_heap_alloc从堆自己的bins中取对象，bins为空时直接从堆的中心池成批取得，
+ * 所以分配必须由调用者串行化；释放时对象不属于任何线程绑定的堆，总是经由远程释放链表送回。
+ * 堆预留的每一段内存都记录在regions中，并且在销毁之前从不单独解除映射，销毁时只需注销页映射表
+ * 中属于大对象页堆的部分，再逐段解除映射。
+ */
+static void *
+sty_heap_small(sty_heap *heap, unsigned cls) {
+    sty_bin *bin = &heap->bins[cls];
+    void *obj = bin->head;
+    uint32_t got;
+    if (obj == NULL) {
+        if ((got = sty_central_fetch(heap, cls, sty_class_batch[cls], &obj)) == 0)
+            return NULL;
+        bin->count = got;
+    }
+    bin->head = *(void **)obj;
+    --bin->count;
+    ++sty_tc.bins[cls].allocs;
+    return obj;
+}
+
+static void *
+sty_heap_loop(sty_heap *heap, size_t bytes) {
+    void *ptr;
+    int i;
+#ifdef STY_DEBUG
+    size_t size = bytes;
+    bytes = sty_debug_need(bytes);
+#endif
+    sty_tcache_heap();      /* 计数记在当前线程的缓存中，线程必须已经登记 */
+    for (i = 0;; ++i) {
+        if (bytes <= STY_SMALL_MAX)
+            ptr = sty_heap_small(heap, sty_class_index[(bytes + 15) >> 4]);
+        else
+            ptr = sty_large_alloc(heap, bytes, 0, 0);
+        if (ptr != NULL) {
+#ifdef STY_DEBUG
+            sty_debug_alloc(ptr, size, 0);
+#endif
+            return ptr;
+        }
+        if (!sty_oom(bytes, i))
+            return NULL;
+    }
+}
+
+STY_API sty_heap_t * STY_CDCEL STY_EXPORT
+sty_heap_create(void) {
+    sty_heap *heap;
+    sty_tcache_heap();
+    heap = (sty_heap *)sty_alloc_aligned(64, sizeof(sty_heap));
+    sty_heap_init(heap, sty_numa_node());
+    heap->user = 1;
+    /* 从此释放小对象时总要比较对象所属的堆 */
+    sty_multi_heap = 1;
+    pthread_mutex_lock(&sty_user_lock);
+    heap->next = sty_user_heaps;
+    if (sty_user_heaps != NULL)
+        sty_user_heaps->prev = heap;
+    sty_user_heaps = heap;
+    pthread_mutex_unlock(&sty_user_lock);
+    return heap;
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_heap_alloc(sty_heap_t *heap, size_t bytes) {
+    void *ptr;
+#ifndef STY_DEBUG
+    if (bytes <= STY_SMALL_MAX && !STY_TRACING() && sty_tc.heap != NULL) {
+        unsigned cls = sty_class_index[(bytes + 15) >> 4];
+        sty_bin *bin = &heap->bins[cls];
+        if ((ptr = bin->head) != NULL) {
+            bin->head = *(void **)ptr;
+            --bin->count;
+            ++sty_tc.bins[cls].allocs;
+            return ptr;
+        }
+    }
+#endif
+    if ((ptr = sty_heap_loop(heap, bytes)) == NULL)
+        exit(STY_ALLOC_OOM);
+    if (STY_TRACING())
+        sty_trace(STY_TRACE_ALLOC, ptr, bytes, 0, NULL);
+    return ptr;
+}
+
+/* 把统计中属于heap的部分扣除，调用者必须保证已经没有线程访问heap */
+static void
+sty_heap_retire(sty_heap *heap) {
+    size_t pages = 0, large = 0, spare = 0, dirty = 0, i;
+    sty_span *span, *empty = NULL;
+    sty_central *c;
+    sty_run *run;
+    unsigned bin;
+    int s;
+    for (i = 0; i < heap->region_count; ++i) {
+        if (heap->regions[i].large)
+            large += heap->regions[i].bytes;
+        else
+            pages += heap->regions[i].bytes;
+    }
+    /* 页源中尚未交给中心池或页堆的部分 */
+    spare = (size_t)(heap->pages_end - heap->pages_cur) + heap->pages_cached * STY_SPAN_SIZE;
+    for (span = heap->pages_clean; span != NULL; span = span->next)
+        spare += STY_SPAN_SIZE;
+    for (s = 0; s < 2; ++s) {
+        for (bin = 0; bin < STY_RUN_BINS; ++bin) {
+            for (run = heap->large_free[s][bin]; run != NULL; run = run->next) {
+                large -= run->bytes;
+                if (s == 0)
+                    dirty += run->bytes;
+            }
+        }
+    }
+    dirty += heap->pages_cached * STY_SPAN_SIZE;
+    /* 销毁时仍然存活的小对象记为已经释放，完全空闲的span不必再还给页源 */
+    pthread_mutex_lock(&sty_threads_lock);
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        c = &heap->centrals[i];
+        sty_central_drain(c, &empty);
+        sty_retired_frees[i] += c->used - heap->bins[i].count;
+    }
+    pthread_mutex_unlock(&sty_threads_lock);
+    atomic_fetch_sub_explicit(&sty_active_bytes, pages - spare + large, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&sty_large_bytes, large, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&sty_large_count, heap->large_live, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&sty_dirty_bytes, dirty, memory_order_relaxed);
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_heap_destroy(sty_heap_t *heap) {
+    sty_region *region;
+    char *page;
+    size_t i;
+    if (heap == NULL)
+        return;
+    pthread_mutex_lock(&sty_user_lock);
+    if (heap->prev != NULL)
+        heap->prev->next = heap->next;
+    else
+        sty_user_heaps = heap->next;
+    if (heap->next != NULL)
+        heap->next->prev = heap->prev;
+    pthread_mutex_unlock(&sty_user_lock);
+    sty_heap_retire(heap);
+    for (i = 0; i < heap->region_count; ++i) {
+        region = &heap->regions[i];
+        /* 先注销再解除映射，否则这段地址可能已经被别处映射为小对象的span */
+        if (region->large) {
+            for (page = region->base; page < region->base + region->bytes; page += (size_t)1 << STY_PAGE_SHIFT)
+                sty_pagemap_set(page, NULL);
+        }
+        sty_os_unmap(region->base, region->bytes);
+    }
+    if (heap->regions != NULL)
+        sty_os_unmap(heap->regions, heap->region_cap * sizeof(sty_region));
+    sty_free(heap);
+}
+
+#ifdef STY_OVERRIDE
+/**
+ * 以STY_OVERRIDE编译时，sty.c额外导出libc的整组堆内存函数，使整个进程(包括第三方库)都改用
+ * sty的内存池，可以静态链接，也可以通过LD_PRELOAD加载。C++的operator new/delete见sty_new.cpp。
+ * 这些函数不属于sty的接口，但必须留在动态符号表中，所以单独标记STY_VISIBLE。
+ */
+
+/* 与libc一致，内存耗尽时返回NULL并把errno设为ENOMEM，而不是结束进程 */
+static void *
+sty_enomem(void *ptr) {
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+STY_VISIBLE void *
+malloc(size_t bytes) {
+    return sty_enomem(sty_alloc_try(bytes, 0, 0));
+}
+
+STY_VISIBLE void
+free(void *ptr) {
+    sty_free(ptr);
+}
+
+STY_VISIBLE void *
+calloc(size_t count, size_t bytes) {
+    if (bytes != 0 && count > SIZE_MAX / bytes) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return sty_enomem(sty_alloc_try(count * bytes, 0, 1));
+}
+
+/* 与glibc一致，realloc(ptr, 0)释放ptr并返回NULL */
+STY_VISIBLE void *
+realloc(void *ptr, size_t bytes) {
+    if (ptr != NULL && bytes == 0) {
+        sty_free(ptr);
+        return NULL;
+    }
+    return sty_enomem(sty_do_realloc(ptr, bytes, 0));
+}
+
+STY_VISIBLE int
+posix_memalign(void **out, size_t align, size_t bytes) {
+    if (align < sizeof(void *) || (align & (align - 1)) != 0)
+        return EINVAL;
+    if ((*out = sty_alloc_try(bytes, align, 0)) == NULL)
+        return ENOMEM;
+    return 0;
+}
+
+STY_VISIBLE void *
+aligned_alloc(size_t align, size_t bytes) {
+    if (align == 0 || (align & (align - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return sty_enomem(sty_alloc_try(bytes, align, 0));
+}
+
+STY_VISIBLE void *
+memalign(size_t align, size_t bytes) {
+    return aligned_alloc(align, bytes);
+}
+
+STY_VISIBLE void *
+valloc(size_t bytes) {
+    pthread_once(&sty_once, sty_init);
+    return aligned_alloc(sty_page_size, bytes);
+}
+
+STY_VISIBLE void *
+pvalloc(size_t bytes) {
+    pthread_once(&sty_once, sty_init);
+    if (bytes > SIZE_MAX - sty_page_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return aligned_alloc(sty_page_size, (bytes + sty_page_size - 1) & ~(sty_page_size - 1));
+}
+
+STY_VISIBLE size_t
+malloc_usable_size(void *ptr) {
+    return sty_usable_size(ptr);
+}
+#endif
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_hugepage_policy(int policy) {
+    if (policy < STY_HUGEPAGE_OFF || policy > STY_HUGEPAGE_1G)
+        return atomic_load_explicit(&sty_hugepage, memory_order_relaxed);
+    return atomic_exchange_explicit(&sty_hugepage, policy, memory_order_relaxed);
+}
+
+STY_API void * STY_CDCEL STY_EXPORT
+sty_alloc_onnode(size_t bytes, int node) {
+    size_t need = bytes;
+    sty_heap *heap;
+    void *ptr;
+    int i;
+#ifdef STY_DEBUG
+    need = sty_debug_need(bytes);
+#endif
+    sty_tcache_heap();      /* 计数记在当前线程的缓存中，线程必须已经登记 */
+    if (node < 0 || node >= sty_numa_nodes)
+        return sty_alloc(bytes);
+    heap = &sty_heaps[node];
+    for (i = 0;; ++i) {
+        if (need <= STY_SMALL_MAX) {
+            /* 绕过线程缓存，线程缓存里的对象属于线程自己的节点 */
+            if (sty_central_fetch(heap, sty_class_index[(need + 15) >> 4], 1, &ptr) == 1) {
+                ++sty_tc.bins[sty_class_index[(need + 15) >> 4]].allocs;
+                break;
+            }
+        } else if ((ptr = sty_large_alloc(heap, need, 0, 0)) != NULL) {
+            break;
+        }
+        if (!sty_oom(need, i))
+            exit(STY_ALLOC_OOM);
+    }
+#ifdef STY_DEBUG
+    sty_debug_alloc(ptr, bytes, 0);
+#endif
+    if (STY_TRACING())
+        sty_trace(STY_TRACE_ALLOC, ptr, bytes, 0, NULL);
+    return ptr;
+}
+
+STY_API long STY_CDCEL STY_EXPORT
+sty_decay_time(long ms) {
+    return atomic_exchange_explicit(&sty_decay_ms, ms, memory_order_relaxed);
+}
+
+STY_API size_t STY_CDCEL STY_EXPORT
+sty_rss_limit(size_t bytes) {
+    size_t old = atomic_exchange_explicit(&sty_rss_max, bytes, memory_order_relaxed);
+    sty_rss_check();
+    return old;
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_purge(void) {
+    sty_heap *heap;
+    int i;
+    pthread_once(&sty_once, sty_init);
+#if STY_RSEQ
+    sty_cpu_drain_all();
+#endif
+    for (i = 0; i < sty_numa_nodes; ++i) {
+        sty_transfer_flush(&sty_heaps[i]);
+        sty_heap_drain(&sty_heaps[i]);
+    }
+    pthread_mutex_lock(&sty_user_lock);
+    for (heap = sty_user_heaps; heap != NULL; heap = heap->next)
+        sty_heap_drain(heap);
+    pthread_mutex_unlock(&sty_user_lock);
+    sty_purge_all();
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_thread_flush(void) {
+    if ((uintptr_t)sty_tc.heap > (uintptr_t)STY_TCACHE_DEAD)
+        sty_tcache_release(&sty_tc);
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_thread_idle(void) {
+    sty_heap *heap = sty_tc.heap;
+    if ((uintptr_t)heap <= (uintptr_t)STY_TCACHE_DEAD)
+        return;
+    sty_tcache_release(&sty_tc);
+    sty_heap_drain(heap);
+    sty_pages_decay(heap, 0);
+}
+
+static void *
+sty_decay_main(void *arg) {
+    struct timespec ts;
+    sty_heap *heap;
+    long decay;
+    int i;
+    (void)arg;
+    while (atomic_load_explicit(&sty_decay_running, memory_order_relaxed)) {
+        decay = atomic_load_explicit(&sty_decay_ms, memory_order_relaxed);
+        decay = decay >= 4 ? decay / 4 : decay >= 0 ? 1 : 1000;
+        if (decay > 1000)
+            decay = 1000;
+        ts.tv_sec = decay / 1000;
+        ts.tv_nsec = (decay % 1000) * 1000000;
+        nanosleep(&ts, NULL);
+        for (i = 0; i < sty_numa_nodes; ++i) {
+            sty_heap_drain(&sty_heaps[i]);
+            sty_pages_decay(&sty_heaps[i], 0);
+        }
+        pthread_mutex_lock(&sty_user_lock);
+        for (heap = sty_user_heaps; heap != NULL; heap = heap->next) {
+            sty_heap_drain(heap);
+            sty_pages_decay(heap, 0);
+        }
+        pthread_mutex_unlock(&sty_user_lock);
+    }
+    return NULL;
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_decay_thread(int enable) {
+    pthread_attr_t attr;
+    pthread_t tid;
+    int expected = !enable, ret = 0;
+    pthread_once(&sty_once, sty_init);
+    if (!atomic_compare_exchange_strong(&sty_decay_running, &expected, enable ? 1 : 0) || !enable)
+        return 0;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, sty_decay_main, NULL) != 0) {
+        atomic_store(&sty_decay_running, 0);
+        ret = -1;
+    }
+    pthread_attr_destroy(&attr);
+    return ret;
+}
+
+/**
+ * fork只把调用fork的线程复制到子进程中。其他线程此刻可能正持有分配器的某个锁，子进程中再也没有
+ * 线程会释放它，所以prepare按分配器内部一贯的嵌套顺序取得全部的锁：堆登记表、线程登记表与对象池
+ * 在外，其次是每个堆的中心池、大对象页堆与页源，最后是只在最内层使用的几个锁。父进程在fork返回
+ * 之后释放它们，子进程则重新初始化它们。
+ */
+static void
+sty_fork_heap(sty_heap *heap, int (*op)(pthread_mutex_t *)) {
+    int i;
+    for (i = 0; i < STY_NUM_CLASSES; ++i)
+        op(&heap->centrals[i].lock);
+    op(&heap->large_lock);
+    op(&heap->pages_lock);
+}
+
+static void
+sty_fork_locks(int (*op)(pthread_mutex_t *)) {
+    struct sty_pool *pool;
+    sty_heap *heap;
+    int i;
+    op(&sty_user_lock);
+    op(&sty_threads_lock);
+    op(&sty_pools_lock);
+    for (pool = sty_pools_all; pool != NULL; pool = pool->all)
+        op(&pool->lock);
+    for (i = 0; i < sty_numa_nodes; ++i)
+        sty_fork_heap(&sty_heaps[i], op);
+    for (heap = sty_user_heaps; heap != NULL; heap = heap->next)
+        sty_fork_heap(heap, op);
+    op(&sty_prof_lock);
+    op(&sty_trace_lock);
+    op(&sty_pagemap_lock);
+}
+
+static int
+sty_fork_reinit(pthread_mutex_t *lock) {
+    return pthread_mutex_init(lock, NULL);
+}
+
+static void
+sty_fork_prepare(void) {
+    sty_fork_locks(pthread_mutex_lock);
+}
+
+static void
+sty_fork_parent(void) {
+    sty_fork_locks(pthread_mutex_unlock);
+}
+
+/* 为带有MADV_DONTFORK、没有被子进程继承的一段地址重新映射零页 */
+static int
+sty_fork_refill(void *base, size_t bytes, int node) {
+    atomic_fetch_add_explicit(&sty_mmap_calls, 1, memory_order_relaxed);
+    if (mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        atomic_fetch_sub_explicit(&sty_mapped_bytes, bytes, memory_order_relaxed);
+        return -1;
+    }
+    sty_os_bind(base, bytes, node);
+    return 0;
+}
+
+/**
+ * 子进程中补上页源和页堆里被MADV_DONTFORK留下的空洞。clean的内存本来就不保证内容，换成新的零页
+ * 没有区别；无法补上的span与run不再使用，它们的地址空间随之泄漏。
+ */
+static void
+sty_fork_remap(sty_heap *heap) {
+    sty_span **link, *span;
+    sty_run *run, *next;
+    unsigned bin;
+    int s;
+    for (link = &heap->pages_clean; (span = *link) != NULL;) {
+        if (span->nofork) {
+            if (sty_fork_refill((char *)span + sty_page_size, STY_SPAN_SIZE - sty_page_size, heap->node) != 0) {
+                *link = span->next;
+                continue;
+            }
+            span->nofork = 0;
+        }
+        link = &span->next;
+    }
+    for (s = 0; s < 2; ++s) {
+        for (bin = 0; bin < STY_RUN_BINS; ++bin) {
+            for (run = heap->large_free[s][bin]; run != NULL; run = next) {
+                next = run->next;
+                if (!run->nofork)
+                    continue;
+                if (sty_fork_refill(run->base, run->bytes, heap->node) != 0) {
+                    /* 留在页映射表中的BUSY状态使相邻的run不会与它合并 */
+                    sty_run_pop(heap, run);
+                    run->state = STY_RUN_BUSY;
+                    continue;
+                }
+                sty_os_hugepage(run->base, run->bytes);
+                run->nofork = 0;
+            }
+        }
+    }
+}
+
+/**
+ * 子进程中只剩下调用fork的线程。其他线程的缓存仍然留在复制来的地址空间里，却再也没有所有者，
+ * 这里把其中的对象还给中心池，把计数并入sty_retired_*，再把它们从线程登记表中摘除；调用fork的线程
+ * 保留自己的缓存，预热好的对象可以直接使用。子进程与父进程共享记录文件，所以子进程不再记录分配
+ * 轨迹，调用fork的线程的缓冲区在重新开始记录时自动清空。后台衰减线程同样没有被复制，需要时在子进程中重新开启。
+ */
+static void
+sty_fork_child(void) {
+    sty_tcache *tc, *next;
+    sty_heap *heap;
+    int i;
+    sty_fork_locks(sty_fork_reinit);
+    atomic_store_explicit(&sty_decay_running, 0, memory_order_relaxed);
+    atomic_store_explicit(&sty_tracing, 0, memory_order_relaxed);
+    sty_trace_fd = -1;
+    for (tc = sty_threads; tc != NULL; tc = next) {
+        next = tc->next;
+        if (tc == &sty_tc)
+            continue;
+        sty_tcache_release(tc);
+        if (tc->trace != NULL && tc->trace != STY_TRACE_DEAD)
+            sty_os_unmap(tc->trace, STY_TRACE_BUF);
+        sty_tcache_retire(tc);
+    }
+    sty_tc.prev = sty_tc.next = NULL;
+    sty_threads = (uintptr_t)sty_tc.heap > (uintptr_t)STY_TCACHE_DEAD ? &sty_tc : NULL;
+    for (i = 0; i < sty_numa_nodes; ++i)
+        sty_fork_remap(&sty_heaps[i]);
+    for (heap = sty_user_heaps; heap != NULL; heap = heap->next)
+        sty_fork_remap(heap);
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_purge_dontfork(int enable) {
+    return atomic_exchange_explicit(&sty_dontfork, enable != 0, memory_order_relaxed);
+}
+
+/* 按sty_tcache_max计算线程缓存的上限；其他线程不加同步地读取sty_class_cache，对齐的32位写入不会撕裂 */
+static void
+sty_tcache_tune(void) {
+    size_t max = atomic_load_explicit(&sty_tcache_max, memory_order_relaxed), cap;
+    int i;
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        cap = max != 0 ? max : (size_t)sty_class_batch[i] * 2;
+        if (cap < sty_class_batch[i])
+            cap = sty_class_batch[i];
+        if (cap > UINT32_MAX / 2)
+            cap = UINT32_MAX / 2;
+        *(volatile uint32_t *)&sty_class_cache[i] = (uint32_t)cap;
+    }
+}
+
+/**
+ * 运行时参数表。值一律经由long long读写，size_t的值按位转换；set在新的值无效时返回-1。
+ * STY_CTL_BOOT的参数在sty_init计算尺寸类别的参数之前由STY_CONF设置，此后只读。
+ */
+#define STY_CTL_INT         0
+#define STY_CTL_LONG        1
+#define STY_CTL_SIZE        2
+#define STY_CTL_TYPE        3
+#define STY_CTL_RO          4
+#define STY_CTL_BOOT        8
+
+typedef struct sty_ctl {
+    const char         *name;
+    int                 flags;
+    long long         (*get)(void);
+    int               (*set)(long long value);
+} sty_ctl;
+
+static long long
+sty_ctl_decay_get(void) {
+    return atomic_load_explicit(&sty_decay_ms, memory_order_relaxed);
+}
+
+static int
+sty_ctl_decay_set(long long value) {
+    if (value < LONG_MIN || value > LONG_MAX)
+        return -1;
+    atomic_store_explicit(&sty_decay_ms, (long)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_hugepage_get(void) {
+    return atomic_load_explicit(&sty_hugepage, memory_order_relaxed);
+}
+
+static int
+sty_ctl_hugepage_set(long long value) {
+    /* STY_CONF中的2m与1g按后缀解析成了字节数 */
+    if (value == (long long)STY_HUGE_2M)
+        value = STY_HUGEPAGE_2M;
+    else if (value == (long long)STY_HUGE_1G)
+        value = STY_HUGEPAGE_1G;
+    if (value < STY_HUGEPAGE_OFF || value > STY_HUGEPAGE_1G)
+        return -1;
+    atomic_store_explicit(&sty_hugepage, (int)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_rss_get(void) {
+    return (long long)atomic_load_explicit(&sty_rss_max, memory_order_relaxed);
+}
+
+static int
+sty_ctl_rss_set(long long value) {
+    sty_rss_limit((size_t)value);
+    return 0;
+}
+
+static long long
+sty_ctl_dontfork_get(void) {
+    return atomic_load_explicit(&sty_dontfork, memory_order_relaxed);
+}
+
+static int
+sty_ctl_dontfork_set(long long value) {
+    sty_purge_dontfork(value != 0);
+    return 0;
+}
+
+static long long
+sty_ctl_oom_get(void) {
+    return atomic_load_explicit(&sty_oom_retry, memory_order_relaxed);
+}
+
+static int
+sty_ctl_oom_set(long long value) {
+    if (value < 0 || value > INT_MAX)
+        return -1;
+    atomic_store_explicit(&sty_oom_retry, (int)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_tcache_get(void) {
+    return (long long)atomic_load_explicit(&sty_tcache_max, memory_order_relaxed);
+}
+
+static int
+sty_ctl_tcache_set(long long value) {
+    atomic_store_explicit(&sty_tcache_max, (size_t)value, memory_order_relaxed);
+    sty_tcache_tune();
+    return 0;
+}
+
+static long long
+sty_ctl_span_get(void) {
+    return (long long)atomic_load_explicit(&sty_span_cache_max, memory_order_relaxed);
+}
+
+static int
+sty_ctl_span_set(long long value) {
+    atomic_store_explicit(&sty_span_cache_max, (size_t)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_direct_get(void) {
+    return (long long)atomic_load_explicit(&sty_direct_min, memory_order_relaxed);
+}
+
+static int
+sty_ctl_direct_set(long long value) {
+    atomic_store_explicit(&sty_direct_min, (size_t)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_slab_get(void) {
+    return (long long)atomic_load_explicit(&sty_pool_slab_min, memory_order_relaxed);
+}
+
+static int
+sty_ctl_slab_set(long long value) {
+    if ((size_t)value == 0)
+        return -1;
+    atomic_store_explicit(&sty_pool_slab_min, (size_t)value, memory_order_relaxed);
+    return 0;
+}
+
+static long long
+sty_ctl_batch_get(void) {
+    return (long long)sty_batch_bytes;
+}
+
+static int
+sty_ctl_batch_set(long long value) {
+    sty_batch_bytes = (size_t)value;
+    return 0;
+}
+
+static long long
+sty_ctl_small_get(void) {
+    return STY_SMALL_MAX;
+}
+
+static long long
+sty_ctl_nodes_get(void) {
+    return sty_numa_nodes;
+}
+
+static const sty_ctl sty_ctls[] = {
+    { "decay_ms",       STY_CTL_LONG,                   sty_ctl_decay_get,      sty_ctl_decay_set },
+    { "hugepages",      STY_CTL_INT,                    sty_ctl_hugepage_get,   sty_ctl_hugepage_set },
+    { "rss_limit",      STY_CTL_SIZE,                   sty_ctl_rss_get,        sty_ctl_rss_set },
+    { "dontfork",       STY_CTL_INT,                    sty_ctl_dontfork_get,   sty_ctl_dontfork_set },
+    { "oom_retry",      STY_CTL_INT,                    sty_ctl_oom_get,        sty_ctl_oom_set },
+    { "tcache_max",     STY_CTL_SIZE,                   sty_ctl_tcache_get,     sty_ctl_tcache_set },
+    { "span_cache",     STY_CTL_SIZE,                   sty_ctl_span_get,       sty_ctl_span_set },
+    { "large_direct",   STY_CTL_SIZE,                   sty_ctl_direct_get,     sty_ctl_direct_set },
+    { "pool_slab_min",  STY_CTL_SIZE,                   sty_ctl_slab_get,       sty_ctl_slab_set },
+    { "batch_bytes",    STY_CTL_SIZE | STY_CTL_BOOT,    sty_ctl_batch_get,      sty_ctl_batch_set },
+    { "small_max",      STY_CTL_SIZE | STY_CTL_RO,      sty_ctl_small_get,      NULL },
+    { "numa_nodes",     STY_CTL_INT | STY_CTL_RO,       sty_ctl_nodes_get,      NULL }
+};
+
+static const size_t         sty_ctl_size[] = { sizeof(int), sizeof(long), sizeof(size_t) };
+
+static const sty_ctl *
+sty_ctl_find(const char *name, size_t len) {
+    size_t i;
+    for (i = 0; i < sizeof(sty_ctls) / sizeof(sty_ctls[0]); ++i) {
+        if (strlen(sty_ctls[i].name) == len && memcmp(sty_ctls[i].name, name, len) == 0)
+            return &sty_ctls[i];
+    }
+    return NULL;
+}
+
+/* 解析STY_CONF中的一个值，成功时返回0 */
+static int
+sty_conf_value(const char *p, size_t len, long long *out) {
+    static const char *const words[] = { "off", "no", "false", "on", "yes", "true", "thp" };
+    unsigned long long value = 0;
+    size_t i = 0, w;
+    int neg = 0;
+    for (w = 0; w < sizeof(words) / sizeof(words[0]); ++w) {
+        if (strlen(words[w]) == len && memcmp(words[w], p, len) == 0) {
+            *out = w >= 3;
+            return 0;
+        }
+    }
+    if (i < len && p[i] == '-') {
+        neg = 1;
+        ++i;
+    }
+    if (i == len || p[i] < '0' || p[i] > '9')
+        return -1;
+    for (; i < len && p[i] >= '0' && p[i] <= '9'; ++i) {
+        if (value > (ULLONG_MAX - (unsigned)(p[i] - '0')) / 10)
+            return -1;
+        value = value * 10 + (unsigned)(p[i] - '0');
+    }
+    if (i + 1 == len) {
+        switch (p[i]) {
+        case 'k': case 'K': w = 10; break;
+        case 'm': case 'M': w = 20; break;
+        case 'g': case 'G': w = 30; break;
+        default: return -1;
+        }
+        if (value > ULLONG_MAX >> w)
+            return -1;
+        value <<= w;
+    } else if (i != len) {
+        return -1;
+    }
+    if (value > (unsigned long long)LLONG_MAX)
+        return -1;
+    *out = neg ? -(long long)value : (long long)value;
+    return 0;
+}
+
+/**
+ * 读取环境变量STY_CONF并逐项设置。分配器此时尚未完成初始化，所以这里既不分配内存也不使用stdio，
+ * 无法识别的项直接写到标准错误。
+ */
+static void
+sty_conf_init(void) {
+    const char *conf, *item, *colon, *end;
+    const sty_ctl *ctl;
+    long long value;
+#ifdef __GLIBC__
+    conf = secure_getenv("STY_CONF");
+#else
+    conf = getenv("STY_CONF");
+#endif
+    for (item = conf; item != NULL && *item != '\0'; item = *end == ',' ? end + 1 : end) {
+        for (end = item; *end != '\0' && *end != ','; ++end)
+            ;
+        if (end == item)
+            continue;
+        colon = memchr(item, ':', (size_t)(end - item));
+        if (colon == NULL || (ctl = sty_ctl_find(item, (size_t)(colon - item))) == NULL
+            || (ctl->flags & STY_CTL_RO) || sty_conf_value(colon + 1, (size_t)(end - colon - 1), &value) != 0
+            || ((ctl->flags & STY_CTL_TYPE) == STY_CTL_SIZE && value < 0)
+            || ((ctl->flags & STY_CTL_TYPE) == STY_CTL_INT && (value < INT_MIN || value > INT_MAX))
+            || ctl->set(value) != 0) {
+            sty_write_all(2, "sty: invalid STY_CONF entry: ", 29);
+            sty_write_all(2, item, (size_t)(end - item));
+            sty_write_all(2, "\n", 1);
+        }
+    }
+}
+
+STY_API int STY_CDCEL STY_EXPORT
+sty_mallctl(const char *name, void *oldp, size_t *oldlenp, const void *newp, size_t newlen) {
+    const sty_ctl *ctl;
+    long long old, value = 0;
+    size_t size;
+    int type;
+    pthread_once(&sty_once, sty_init);
+    if (name == NULL || (ctl = sty_ctl_find(name, strlen(name))) == NULL)
+        return -1;
+    type = ctl->flags & STY_CTL_TYPE;
+    size = sty_ctl_size[type];
+    if ((oldp != NULL && (oldlenp == NULL || *oldlenp != size))
+        || (newp != NULL && (newlen != size || (ctl->flags & (STY_CTL_RO | STY_CTL_BOOT)))))
+        return -1;
+    if (newp != NULL) {
+        if (type == STY_CTL_INT) {
+            int v;
+            memcpy(&v, newp, sizeof(v));
+            value = v;
+        } else if (type == STY_CTL_LONG) {
+            long v;
+            memcpy(&v, newp, sizeof(v));
+            value = v;
+        } else {
+            size_t v;
+            memcpy(&v, newp, sizeof(v));
+            value = (long long)v;
+        }
+    }
+    old = ctl->get();
+    if (newp != NULL && ctl->set(value) != 0)
+        return -1;
+    if (oldp != NULL) {
+        if (type == STY_CTL_INT) {
+            int v = (int)old;
+            memcpy(oldp, &v, sizeof(v));
+        } else if (type == STY_CTL_LONG) {
+            long v = (long)old;
+            memcpy(oldp, &v, sizeof(v));
+        } else {
+            size_t v = (size_t)old;
+            memcpy(oldp, &v, sizeof(v));
+        }
+    }
+    return 0;
+}
+
+/**
+ * 其他线程的计数只由其所有者写入，这里不加同步地读取：对齐的字长读写不会撕裂，读到的至多是稍旧
+ * 的值，对于统计来说足够了。
+ */
+#define STY_PEEK(type, lvalue)  (*(volatile type *)&(lvalue))
+
+static void
+sty_central_stats(sty_class_stats *cs, sty_central *c, int cls) {
+    pthread_mutex_lock(&c->lock);
+    cs->spans += c->spans;
+    cs->central_cached += c->spans * ((STY_SPAN_SIZE - sty_class_offset[cls]) / sty_class_size[cls]) - c->used;
+    pthread_mutex_unlock(&c->lock);
+#if STY_TRANSFER
+    cs->transfer_cached += (size_t)atomic_load_explicit(&c->batches, memory_order_relaxed) * sty_class_batch[cls];
+#endif
+}
+
+STY_API void STY_CDCEL STY_EXPORT
+sty_stats_get(sty_stats *stats) {
+    uint64_t allocs[STY_NUM_CLASSES], frees[STY_NUM_CLASSES];
+    sty_class_stats *cs;
+    sty_heap *heap;
+    sty_tcache *tc;
+    int i, h;
+    pthread_once(&sty_once, sty_init);
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&sty_threads_lock);
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        allocs[i] = sty_retired_allocs[i];
+        frees[i] = sty_retired_frees[i];
+    }
+    for (tc = sty_threads; tc != NULL; tc = tc->next) {
+        for (i = 0; i < STY_NUM_CLASSES; ++i) {
+            allocs[i] += STY_PEEK(uint64_t, tc->bins[i].allocs);
+            frees[i] += STY_PEEK(uint64_t, tc->bins[i].frees);
+            stats->classes[i].thread_cached += STY_PEEK(uint32_t, tc->bins[i].count);
+        }
+        ++stats->threads;
+    }
+    pthread_mutex_unlock(&sty_threads_lock);
+    for (i = 0; i < STY_NUM_CLASSES; ++i) {
+        cs = &stats->classes[i];
+        cs->size = sty_class_size[i];
+        cs->allocs = (size_t)allocs[i];
+        cs->frees = (size_t)frees[i];
+        /* 一个线程分配、另一个线程释放时，两边的计数不是同一时刻读到的 */
+        cs->live = allocs[i] > frees[i] ? (size_t)(allocs[i] - frees[i]) : 0;
+        cs->bytes = cs->live * cs->size;
+        for (h = 0; h < sty_numa_nodes; ++h)
+            sty_central_stats(cs, &sty_heaps[h].centrals[i], i);
+    }
+    /* 由sty_heap_create创建的堆自己缓存的对象计入thread_cached */
+    pthread_mutex_lock(&sty_user_lock);
+    for (heap = sty_user_heaps; heap != NULL; heap = heap->next) {
+        for (i = 0; i < STY_NUM_CLASSES; ++i) {
+            sty_central_stats(&stats->classes[i], &heap->centrals[i], i);
+            stats->classes[i].thread_cached += STY_PEEK(uint32_t, heap->bins[i].count);
+        }
+    }
+    pthread_mutex_unlock(&sty_user_lock);
+#if STY_RSEQ
+    for (h = 0; h < (int)sty_cpu_count; ++h) {
+        uint64_t *counts = (uint64_t *)(sty_cpu_slabs + ((size_t)h << STY_CPU_SLAB_SHIFT));
+        for (i = 0; i < STY_NUM_CLASSES; ++i)
+            stats->classes[i].cpu_cached += STY_PEEK(uint64_t, counts[i]);
+    }
+#endif
+    stats->large_count = atomic_load_explicit(&sty_large_count, memory_order_relaxed);
+    stats->large_bytes = atomic_load_explicit(&sty_large_bytes, memory_order_relaxed);
+    stats->active_bytes = atomic_load_explicit(&sty_active_bytes, memory_order_relaxed);
+    stats->dirty_bytes = atomic_load_explicit(&sty_dirty_bytes, memory_order_relaxed);
+    stats->mapped_bytes = atomic_load_explicit(&sty_mapped_bytes, memory_order_relaxed);
+    stats->mmap_calls = atomic_load_explicit(&sty_mmap_calls, memory_order_relaxed);
+    stats->munmap_calls = atomic_load_explicit(&sty_munmap_calls, memory_order_relaxed);
+}
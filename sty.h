@@ -1,7 +1,15 @@
 
 #ifndef __STY__H__
 #define __STY__H__
-
-
+#include "core/sty_types.h"
+#include "core/sty_memory.h"
+#include "core/sty_class.h"
+#include "core/sty_arena.h"
+#include "core/sty_pool.h"
+#include "core/sty_heap.h"
+#include "core/sty_stats.h"
+#include "core/sty_profile.h"
+#include "core/sty_trace.h"
+#include "core/sty_ctl.h"
 
 #endif
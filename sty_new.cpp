@@ -0,0 +1,118 @@
+
+#include "sty.h"
+#include <new>
+
+/**
+ * 与STY_OVERRIDE一同编译进libsty_malloc，把C++的全局operator new/delete交给sty的内存池。
+ * 内存耗尽时，抛出异常的版本按标准调用std::new_handler，没有处理函数时抛出std::bad_alloc；
+ * 不抛出异常的版本返回nullptr。带大小的operator delete直接走sty_free_sized。
+ */
+
+static void *sty_new(std::size_t bytes) {
+    void *ptr;
+    while ((ptr = sty_try_alloc(bytes)) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+    return ptr;
+}
+
+#if __cpp_aligned_new
+static void *sty_new_aligned(std::size_t bytes, std::size_t align) {
+    void *ptr;
+    while ((ptr = sty_try_alloc_aligned(align, bytes)) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+    return ptr;
+}
+#endif
+
+void *operator new(std::size_t bytes) {
+    return sty_new(bytes);
+}
+
+void *operator new[](std::size_t bytes) {
+    return sty_new(bytes);
+}
+
+void *operator new(std::size_t bytes, const std::nothrow_t &) noexcept {
+    return sty_try_alloc(bytes);
+}
+
+void *operator new[](std::size_t bytes, const std::nothrow_t &) noexcept {
+    return sty_try_alloc(bytes);
+}
+
+void operator delete(void *ptr) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    sty_free(ptr);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void *ptr, std::size_t bytes) noexcept {
+    sty_free_sized(ptr, bytes);
+}
+
+void operator delete[](void *ptr, std::size_t bytes) noexcept {
+    sty_free_sized(ptr, bytes);
+}
+#endif
+
+#if __cpp_aligned_new
+/* 对齐分配可能落在更大的尺寸类别中，释放时不能按大小直接找回类别 */
+void *operator new(std::size_t bytes, std::align_val_t align) {
+    return sty_new_aligned(bytes, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t align) {
+    return sty_new_aligned(bytes, static_cast<std::size_t>(align));
+}
+
+void *operator new(std::size_t bytes, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return sty_try_alloc_aligned(static_cast<std::size_t>(align), bytes);
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return sty_try_alloc_aligned(static_cast<std::size_t>(align), bytes);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    sty_free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    sty_free(ptr);
+}
+#endif
@@ -0,0 +1,89 @@
+
+#ifndef __STY__TEST__H__
+#define __STY__TEST__H__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../sty.h"
+
+/**
+ * 各个测试程序共用的检查工具。每个程序由ctest单独运行，检查失败时打印文件、行号与条件并以1退出，
+ * 全部通过时以0退出。
+ */
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* 按字节填充一块内存，之后由test_verify检查内容是否被其他分配改写 */
+static inline void
+test_fill(void *ptr, size_t bytes, unsigned seed) {
+    unsigned char *p = (unsigned char *)ptr;
+    size_t i;
+    for (i = 0; i < bytes; ++i)
+        p[i] = (unsigned char)(seed + i * 131);
+}
+
+static inline int
+test_verify(const void *ptr, size_t bytes, unsigned seed) {
+    const unsigned char *p = (const unsigned char *)ptr;
+    size_t i;
+    for (i = 0; i < bytes; ++i) {
+        if (p[i] != (unsigned char)(seed + i * 131))
+            return 0;
+    }
+    return 1;
+}
+
+static inline int
+test_aligned(const void *ptr, size_t align) {
+    return ((uintptr_t)ptr & (align - 1)) == 0;
+}
+
+/* 所有尺寸类别正在使用的对象个数之和 */
+static inline size_t
+test_live(void) {
+    sty_stats stats;
+    size_t live = 0;
+    int i;
+    sty_stats_get(&stats);
+    for (i = 0; i < STY_STATS_CLASSES; ++i)
+        live += stats.classes[i].live;
+    return live;
+}
+
+static inline size_t
+test_threads(void) {
+    sty_stats stats;
+    sty_stats_get(&stats);
+    return stats.threads;
+}
+
+/* 在子进程中运行fn，返回子进程的退出码；被信号终止时返回128加信号编号 */
+static inline int
+test_in_child(void (*fn)(void)) {
+    int status;
+    pid_t pid = fork();
+    if (pid == 0) {
+        alarm(30);
+        fn();
+        _exit(0);
+    }
+    TEST_CHECK(pid > 0);
+    TEST_CHECK(waitpid(pid, &status, 0) == pid);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+#endif
@@ -0,0 +1,191 @@
+#include "test.h"
+
+/**
+ * sty_alloc一族：每个尺寸类别的容量、对齐与内容，带大小的释放，realloc与calloc，任意对齐的分配，
+ * 以及大小溢出时的行为。
+ */
+
+#define TEST_OBJS       256
+
+static void
+test_classes(void) {
+    void *objs[TEST_OBJS];
+    size_t bytes, usable;
+    unsigned cls;
+    int i;
+    for (bytes = 0; bytes <= STY_CLASS_MAX; ++bytes) {
+        for (i = 0; i < 8; ++i) {
+            objs[i] = sty_alloc(bytes);
+            TEST_CHECK(objs[i] != NULL && test_aligned(objs[i], 16));
+            TEST_CHECK(sty_usable_size(objs[i]) >= bytes);
+            test_fill(objs[i], bytes, (unsigned)(bytes + i));
+        }
+        for (i = 0; i < 8; ++i) {
+            TEST_CHECK(test_verify(objs[i], bytes, (unsigned)(bytes + i)));
+            if (i & 1)
+                sty_free(objs[i]);
+            else
+                sty_free_sized(objs[i], bytes);
+        }
+    }
+    /* 同一个类别的对象互不重叠，带大小释放后再分配仍然得到该类别的对象 */
+    for (cls = 0; cls < STY_CLASS_COUNT; ++cls) {
+        usable = sty_usable_size(objs[0] = sty_alloc_class(cls));
+        TEST_CHECK(usable >= 16 && sty_size_class(usable) == cls);
+        for (i = 1; i < TEST_OBJS; ++i)
+            objs[i] = sty_alloc_class(cls);
+        for (i = 0; i < TEST_OBJS; ++i)
+            test_fill(objs[i], usable, (unsigned)i);
+        for (i = 0; i < TEST_OBJS; ++i) {
+            TEST_CHECK(test_verify(objs[i], usable, (unsigned)i));
+            sty_free_sized(objs[i], usable);
+        }
+    }
+}
+
+static void
+test_at_least(void) {
+    size_t bytes, actual;
+    void *ptr;
+    for (bytes = 1; bytes < ((size_t)1 << 22); bytes = bytes * 3 / 2 + 1) {
+        ptr = sty_alloc_at_least(bytes, &actual);
+        TEST_CHECK(actual >= bytes && sty_usable_size(ptr) >= actual);
+        test_fill(ptr, actual, 7);
+        TEST_CHECK(test_verify(ptr, actual, 7));
+        sty_free_sized(ptr, actual);
+    }
+}
+
+static void
+test_realloc(void) {
+    size_t bytes, prev = 24;
+    char *ptr = (char *)sty_realloc(NULL, prev);
+    test_fill(ptr, prev, 3);
+    /* 逐步增长到大对象再缩回小对象，每一步都保留原来的内容 */
+    for (bytes = 40; bytes < ((size_t)1 << 24); bytes = bytes * 2 + 8) {
+        ptr = (char *)sty_realloc(ptr, bytes);
+        TEST_CHECK(test_verify(ptr, prev, 3));
+        test_fill(ptr, bytes, 3);
+        prev = bytes;
+    }
+    for (; bytes > 16; bytes /= 3) {
+        ptr = (char *)sty_realloc(ptr, bytes);
+        TEST_CHECK(test_verify(ptr, bytes < prev ? bytes : prev, 3));
+        test_fill(ptr, bytes, 3);
+        prev = bytes;
+    }
+    sty_free(ptr);
+}
+
+/* sty_realloc原地返回的对象必须能够按新的大小调用sty_free_sized释放 */
+static void
+test_realloc_sized(void) {
+    void *objs[TEST_OBJS];
+    size_t from, to;
+    int i;
+    for (from = 16; from <= STY_CLASS_MAX; from += 16) {
+        for (to = 1; to < from; to += 7) {
+            for (i = 0; i < 4; ++i)
+                sty_free_sized(sty_realloc(sty_alloc(from), to), to);
+            for (i = 0; i < 64; ++i) {
+                objs[i] = sty_alloc(to);
+                TEST_CHECK(sty_size_class(sty_usable_size(objs[i])) == sty_size_class(to));
+            }
+            for (i = 0; i < 64; ++i)
+                sty_free_sized(objs[i], to);
+        }
+    }
+    for (i = 0; i < TEST_OBJS; ++i) {
+        objs[i] = sty_alloc_aligned(64, 64);
+        TEST_CHECK(test_aligned(objs[i], 64));
+    }
+    for (i = 0; i < TEST_OBJS; ++i)
+        sty_free(objs[i]);
+}
+
+static void
+test_calloc(void) {
+    size_t bytes, i;
+    unsigned char *ptr;
+    for (bytes = 1; bytes < ((size_t)1 << 22); bytes = bytes * 5 / 2 + 3) {
+        /* 先弄脏同样大小的内存并释放，calloc复用它们时必须重新清零 */
+        ptr = (unsigned char *)sty_alloc(bytes);
+        memset(ptr, 0xa5, bytes);
+        sty_free(ptr);
+        ptr = (unsigned char *)sty_calloc(bytes, 1);
+        for (i = 0; i < bytes; ++i)
+            TEST_CHECK(ptr[i] == 0);
+        sty_free(ptr);
+    }
+}
+
+static void
+test_aligned_sizes(void) {
+    static void *objs[64];
+    size_t align, bytes;
+    int round, n, i;
+    /* 第二轮复用第一轮释放的对象与run */
+    for (round = 0; round < 2; ++round) {
+        for (align = 1; align <= ((size_t)1 << 21); align <<= 1) {
+            n = 0;
+            for (bytes = 1; bytes <= ((size_t)1 << 20) && n < 64; bytes = bytes * 3 + 5) {
+                objs[n] = sty_alloc_aligned(align, bytes);
+                TEST_CHECK(test_aligned(objs[n], align) && sty_usable_size(objs[n]) >= bytes);
+                test_fill(objs[n], bytes, (unsigned)n);
+                ++n;
+            }
+            for (i = 0, bytes = 1; i < n; ++i, bytes = bytes * 3 + 5) {
+                TEST_CHECK(test_verify(objs[i], bytes, (unsigned)i));
+                sty_free(objs[i]);
+            }
+        }
+    }
+    /* 不是2的幂的对齐要求向上取整 */
+    objs[0] = sty_alloc_aligned(48, 100);
+    TEST_CHECK(test_aligned(objs[0], 64));
+    sty_free(objs[0]);
+    objs[0] = sty_try_alloc_aligned(4096, 10);
+    TEST_CHECK(objs[0] != NULL && test_aligned(objs[0], 4096));
+    sty_free(objs[0]);
+    TEST_CHECK(sty_try_alloc_aligned(SIZE_MAX, 16) == NULL);
+}
+
+static void
+test_calloc_overflow(void) {
+    sty_calloc(SIZE_MAX / 2, 3);
+}
+
+static void
+test_realloc_overflow(void) {
+    sty_realloc(sty_alloc(16), SIZE_MAX - 8);
+}
+
+static void
+test_alloc_overflow(void) {
+    sty_alloc(SIZE_MAX);
+}
+
+static void
+test_overflow(void) {
+    int oom = STY_ALLOC_OOM & 0xff;
+    TEST_CHECK(sty_try_alloc(SIZE_MAX) == NULL);
+    TEST_CHECK(sty_try_alloc(SIZE_MAX - 4096) == NULL);
+    TEST_CHECK(test_in_child(test_calloc_overflow) == oom);
+    TEST_CHECK(test_in_child(test_realloc_overflow) == oom);
+    TEST_CHECK(test_in_child(test_alloc_overflow) == oom);
+}
+
+int
+main(void) {
+    /* 溢出的请求没有重试的意义 */
+    int retry = 0;
+    TEST_CHECK(sty_mallctl("oom_retry", NULL, NULL, &retry, sizeof(retry)) == 0);
+    test_classes();
+    test_at_least();
+    test_realloc();
+    test_realloc_sized();
+    test_calloc();
+    test_aligned_sizes();
+    test_overflow();
+    return 0;
+}
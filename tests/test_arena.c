@@ -0,0 +1,46 @@
+#include "test.h"
+
+/**
+ * 区域分配：每次返回16字节对齐且互不重叠的内存，0字节的请求同样如此；reset之后复用原来的内存块，
+ * 超过内存块大小的请求单独分配。
+ */
+
+#define TEST_OBJS       20000
+
+static void
+test_arena(sty_arena_t *arena) {
+    static char *objs[TEST_OBJS];
+    static size_t sizes[TEST_OBJS];
+    int i;
+    for (i = 0; i < TEST_OBJS; ++i) {
+        sizes[i] = i % 997 == 0 ? (size_t)(1 << 17) + (size_t)i : (size_t)(i % 300);
+        objs[i] = (char *)sty_arena_alloc(arena, sizes[i]);
+        TEST_CHECK(test_aligned(objs[i], 16));
+        test_fill(objs[i], sizes[i], (unsigned)i);
+        /* 0字节的请求也必须得到互不相同的地址 */
+        TEST_CHECK(i == 0 || objs[i] != objs[i - 1]);
+    }
+    for (i = 0; i < TEST_OBJS; ++i)
+        TEST_CHECK(test_verify(objs[i], sizes[i], (unsigned)i));
+}
+
+int
+main(void) {
+    sty_arena_t *arena = sty_arena_create();
+    size_t mapped;
+    sty_stats stats;
+    int round, i;
+    for (round = 0; round < 5; ++round) {
+        test_arena(arena);
+        sty_arena_reset(arena);
+    }
+    /* 大量0字节的请求不应当每次都占用一个新的内存块 */
+    sty_stats_get(&stats);
+    mapped = stats.active_bytes;
+    for (i = 0; i < 100000; ++i)
+        sty_arena_alloc(arena, 0);
+    sty_stats_get(&stats);
+    TEST_CHECK(stats.active_bytes - mapped < ((size_t)4 << 20));
+    sty_arena_destroy(arena);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "test.h"
+
+/**
+ * STY_CONF与sty_mallctl：ctest以
+ *     STY_CONF=tcache_max:256,decay_ms:2k,bogus:1,span_cache:8,hugepages:off,large_direct:32m,oom_retry:x
+ * 运行此程序，其中无法识别的项被忽略，其余的项在首次使用分配器时生效。随后检查sty_mallctl对
+ * 名字、大小与只读参数的校验。
+ */
+
+static long
+test_long(const char *name) {
+    long value = -1;
+    size_t len = sizeof(value);
+    TEST_CHECK(sty_mallctl(name, &value, &len, NULL, 0) == 0);
+    return value;
+}
+
+static size_t
+test_size(const char *name) {
+    size_t value = 0, len = sizeof(value);
+    TEST_CHECK(sty_mallctl(name, &value, &len, NULL, 0) == 0);
+    return value;
+}
+
+static int
+test_int(const char *name) {
+    int value = -1;
+    size_t len = sizeof(value);
+    TEST_CHECK(sty_mallctl(name, &value, &len, NULL, 0) == 0);
+    return value;
+}
+
+int
+main(void) {
+    size_t value, old, len = sizeof(old);
+    int small;
+    const char *conf = getenv("STY_CONF");
+    TEST_CHECK(conf != NULL && strstr(conf, "tcache_max:256") != NULL);
+    sty_free(sty_alloc(16));
+    TEST_CHECK(test_size("tcache_max") == 256);
+    TEST_CHECK(test_long("decay_ms") == 2048);
+    TEST_CHECK(test_size("span_cache") == 8);
+    TEST_CHECK(test_int("hugepages") == STY_HUGEPAGE_OFF);
+    TEST_CHECK(test_size("large_direct") == ((size_t)32 << 20));
+    /* 无效的值被忽略，保留默认值 */
+    TEST_CHECK(test_int("oom_retry") == STY_ALLOC_FAILED_RETRY);
+    TEST_CHECK(test_size("small_max") == STY_CLASS_MAX);
+    TEST_CHECK(test_int("numa_nodes") >= 1);
+    /* 修改后读回，同时得到此前的值 */
+    value = 64;
+    TEST_CHECK(sty_mallctl("tcache_max", &old, &len, &value, sizeof(value)) == 0 && old == 256);
+    TEST_CHECK(test_size("tcache_max") == 64);
+    /* 名字不存在、大小不符、只读或只能在启动时设置的参数都返回-1 */
+    TEST_CHECK(sty_mallctl("bogus", &old, &len, NULL, 0) == -1);
+    len = sizeof(int);
+    TEST_CHECK(sty_mallctl("tcache_max", &old, &len, NULL, 0) == -1);
+    small = 1;
+    TEST_CHECK(sty_mallctl("tcache_max", NULL, NULL, &small, sizeof(small)) == -1);
+    TEST_CHECK(sty_mallctl("small_max", NULL, NULL, &value, sizeof(value)) == -1);
+    TEST_CHECK(sty_mallctl("batch_bytes", NULL, NULL, &value, sizeof(value)) == -1);
+    TEST_CHECK(test_size("tcache_max") == 64);
+    return 0;
+}
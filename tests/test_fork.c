@@ -0,0 +1,116 @@
+#include "test.h"
+
+/**
+ * 多线程进程中的fork：其他线程正在分配、释放、创建对象池与记录统计时，子进程仍然能够使用分配器，
+ * 而不会因为fork时被其他线程持有的锁而死锁。子进程在30秒内没有退出即算失败。
+ */
+
+#define TEST_THREADS    4
+#define TEST_FORKS      200
+
+static _Atomic(int) test_stop;
+
+static void *
+test_busy(void *arg) {
+    void *objs[32];
+    sty_pool_t *pool;
+    uint64_t seed = (uint64_t)(uintptr_t)arg * 2654435761u + 1;
+    sty_stats stats;
+    int i;
+    while (!test_stop) {
+        for (i = 0; i < 32; ++i) {
+            seed = seed * 6364136223846793005u + 1442695040888963407u;
+            objs[i] = sty_alloc((size_t)(seed >> 40) % (i == 0 ? (1 << 20) : 2048));
+        }
+        for (i = 0; i < 32; ++i)
+            sty_free(objs[i]);
+        pool = sty_pool_create(64, STY_POOL_THREAD_CACHE);
+        sty_pool_free(pool, sty_pool_alloc(pool));
+        sty_pool_destroy(pool);
+        sty_stats_get(&stats);
+    }
+    return NULL;
+}
+
+/* 只使用对象池的短命线程：第一次分配在持有pool->lock时补充slab */
+static void *
+test_pool_user(void *arg) {
+    sty_pool_t *pool = (sty_pool_t *)arg;
+    void *objs[8];
+    int i;
+    for (i = 0; i < 8; ++i)
+        objs[i] = sty_pool_alloc(pool);
+    for (i = 0; i < 8; ++i)
+        sty_pool_free(pool, objs[i]);
+    return NULL;
+}
+
+static void *
+test_spawner(void *arg) {
+    sty_pool_t *pool;
+    pthread_t thread;
+    (void)arg;
+    while (!test_stop) {
+        pool = sty_pool_create(100000, 0);
+        TEST_CHECK(pthread_create(&thread, NULL, test_pool_user, pool) == 0);
+        pthread_join(thread, NULL);
+        sty_pool_destroy(pool);
+    }
+    return NULL;
+}
+
+static void *
+test_churn(void *arg) {
+    void *objs[256];
+    int i;
+    (void)arg;
+    for (i = 0; i < 256; ++i)
+        objs[i] = sty_alloc((size_t)i * 8);
+    for (i = 0; i < 256; ++i)
+        sty_free(objs[i]);
+    return NULL;
+}
+
+static void
+test_child(void) {
+    void *objs[1000];
+    pthread_t thread;
+    size_t bytes;
+    int i;
+    for (i = 0; i < 1000; ++i) {
+        bytes = (size_t)(i * 37) % 70000;
+        objs[i] = sty_alloc(bytes);
+        test_fill(objs[i], bytes < 8 ? bytes : 8, (unsigned)i);
+    }
+    for (i = 0; i < 1000; ++i) {
+        bytes = (size_t)(i * 37) % 70000;
+        TEST_CHECK(test_verify(objs[i], bytes < 8 ? bytes : 8, (unsigned)i));
+        sty_free(objs[i]);
+    }
+    /* 子进程中只剩下fork的线程，新建的线程同样可以使用分配器 */
+    TEST_CHECK(test_threads() == 1);
+    TEST_CHECK(pthread_create(&thread, NULL, test_churn, NULL) == 0);
+    pthread_join(thread, NULL);
+}
+
+int
+main(void) {
+    pthread_t threads[TEST_THREADS + 1];
+    int i;
+    sty_free(sty_alloc(16));
+    for (i = 0; i < TEST_THREADS; ++i)
+        TEST_CHECK(pthread_create(&threads[i], NULL, test_busy, (void *)(uintptr_t)(i + 1)) == 0);
+    TEST_CHECK(pthread_create(&threads[TEST_THREADS], NULL, test_spawner, NULL) == 0);
+    for (i = 0; i < TEST_FORKS; ++i) {
+        TEST_CHECK(test_in_child(test_child) == 0);
+        /* 后一半在清除物理页时加上MADV_DONTFORK */
+        if (i == TEST_FORKS / 2)
+            sty_purge_dontfork(1);
+        if (i % 16 == 0)
+            sty_purge();
+    }
+    test_stop = 1;
+    for (i = 0; i <= TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    return 0;
+}
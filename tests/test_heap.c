@@ -0,0 +1,81 @@
+#include "test.h"
+
+/**
+ * 独立的堆与批量接口：从sty_heap_t分配的对象可以在任何线程中释放，销毁堆之后其内存整体归还；
+ * sty_alloc_bulk得到的对象互不重叠，可以由sty_free_bulk或逐个释放。
+ */
+
+#define TEST_OBJS       5000
+
+static void *test_objs[TEST_OBJS];
+
+static void *
+test_free_remote(void *arg) {
+    int i;
+    (void)arg;
+    for (i = 0; i < TEST_OBJS; i += 2)
+        sty_free(test_objs[i]);
+    return NULL;
+}
+
+static void
+test_heap(void) {
+    sty_heap_t *heap;
+    pthread_t thread;
+    sty_stats before, after;
+    size_t bytes;
+    int round, i;
+    sty_stats_get(&before);
+    for (round = 0; round < 20; ++round) {
+        heap = sty_heap_create();
+        for (i = 0; i < TEST_OBJS; ++i) {
+            bytes = i % 100 == 0 ? (size_t)(64 << 10) : (size_t)(i % 2000) + 1;
+            test_objs[i] = sty_heap_alloc(heap, bytes);
+            TEST_CHECK(test_aligned(test_objs[i], 16) && sty_usable_size(test_objs[i]) >= bytes);
+            test_fill(test_objs[i], bytes < 64 ? bytes : 64, (unsigned)i);
+        }
+        /* 一半在其他线程中释放，一半随堆一起销毁 */
+        TEST_CHECK(pthread_create(&thread, NULL, test_free_remote, NULL) == 0);
+        pthread_join(thread, NULL);
+        for (i = 1; i < TEST_OBJS; i += 2) {
+            bytes = i % 100 == 0 ? (size_t)(64 << 10) : (size_t)(i % 2000) + 1;
+            TEST_CHECK(test_verify(test_objs[i], bytes < 64 ? bytes : 64, (unsigned)i));
+            if (i % 3 == 0)
+                test_objs[i] = sty_realloc(test_objs[i], bytes * 2);
+        }
+        sty_heap_destroy(heap);
+    }
+    sty_stats_get(&after);
+    TEST_CHECK(after.mapped_bytes < before.mapped_bytes + ((size_t)64 << 20));
+}
+
+static void
+test_bulk(void) {
+    static void *objs[TEST_OBJS];
+    size_t bytes;
+    int i;
+    for (bytes = 1; bytes <= ((size_t)1 << 16); bytes = bytes * 2 + 1) {
+        sty_alloc_bulk(bytes, TEST_OBJS, objs);
+        for (i = 0; i < TEST_OBJS; ++i) {
+            TEST_CHECK(test_aligned(objs[i], 16) && sty_usable_size(objs[i]) >= bytes);
+            test_fill(objs[i], bytes < 32 ? bytes : 32, (unsigned)i);
+        }
+        for (i = 0; i < TEST_OBJS; ++i)
+            TEST_CHECK(test_verify(objs[i], bytes < 32 ? bytes : 32, (unsigned)i));
+        if (bytes & 2) {
+            for (i = 0; i < TEST_OBJS; ++i)
+                sty_free(objs[i]);
+        } else {
+            sty_free(objs[7]);
+            objs[7] = NULL;
+            sty_free_bulk(objs, TEST_OBJS);
+        }
+    }
+}
+
+int
+main(void) {
+    test_heap();
+    test_bulk();
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "test.h"
+
+/**
+ * 对象池：对象按16字节对齐、互不重叠，有无线程缓存时都能在多个线程之间分配与释放；销毁的对象池
+ * 复用描述符之后，其他线程缓存中残留的旧对象不会出现在新的对象池中；线程退出时缓存的对象回到对象池。
+ */
+
+#define TEST_THREADS    4
+#define TEST_OBJS       2000
+
+static sty_pool_t *test_pool;
+
+static void *
+test_worker(void *arg) {
+    static _Thread_local void *objs[TEST_OBJS];
+    size_t size = (size_t)(uintptr_t)arg;
+    size_t fill = size < 256 ? size : 256;
+    int round, i;
+    for (round = 0; round < 20; ++round) {
+        for (i = 0; i < TEST_OBJS; ++i) {
+            objs[i] = sty_pool_alloc(test_pool);
+            TEST_CHECK(test_aligned(objs[i], 16));
+            test_fill(objs[i], fill, (unsigned)i);
+        }
+        for (i = 0; i < TEST_OBJS; ++i) {
+            TEST_CHECK(test_verify(objs[i], fill, (unsigned)i));
+            sty_pool_free(test_pool, objs[i]);
+        }
+    }
+    return NULL;
+}
+
+static void
+test_threads_share(size_t size, int flags) {
+    pthread_t threads[TEST_THREADS];
+    int i;
+    test_pool = sty_pool_create(size, flags);
+    for (i = 0; i < TEST_THREADS; ++i)
+        TEST_CHECK(pthread_create(&threads[i], NULL, test_worker, (void *)(uintptr_t)size) == 0);
+    for (i = 0; i < TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    sty_pool_destroy(test_pool);
+}
+
+static void
+test_reuse(void) {
+    sty_pool_t *old, *pool;
+    void *objs[64];
+    int i, j;
+    for (i = 0; i < 100; ++i) {
+        old = sty_pool_create(64, STY_POOL_THREAD_CACHE);
+        for (j = 0; j < 64; ++j)
+            objs[j] = sty_pool_alloc(old);
+        for (j = 0; j < 64; ++j)
+            sty_pool_free(old, objs[j]);
+        sty_pool_destroy(old);
+        /* 新的对象池可能复用同一个描述符，但不会交出旧对象池的对象 */
+        pool = sty_pool_create(64, STY_POOL_THREAD_CACHE);
+        for (j = 0; j < 64; ++j) {
+            objs[j] = sty_pool_alloc(pool);
+            memset(objs[j], j, 64);
+        }
+        for (j = 0; j < 64; ++j)
+            sty_pool_free(pool, objs[j]);
+        sty_pool_destroy(pool);
+    }
+}
+
+/* 只向对象池释放的线程退出时，缓存项中的对象同样还给对象池 */
+static void *
+test_free_only(void *arg) {
+    void **objs = (void **)arg;
+    int i;
+    for (i = 0; i < 8; ++i)
+        sty_pool_free(test_pool, objs[i]);
+    return NULL;
+}
+
+static void
+test_exit(void) {
+    pthread_t thread;
+    void *given[8], *objs[64];
+    int found = 0, i, j;
+    test_pool = sty_pool_create(64, STY_POOL_THREAD_CACHE);
+    for (i = 0; i < 8; ++i)
+        given[i] = sty_pool_alloc(test_pool);
+    TEST_CHECK(pthread_create(&thread, NULL, test_free_only, given) == 0);
+    pthread_join(thread, NULL);
+    for (i = 0; i < 64; ++i) {
+        objs[i] = sty_pool_alloc(test_pool);
+        for (j = 0; j < 8; ++j)
+            found += objs[i] == given[j];
+    }
+    TEST_CHECK(found == 8);
+    for (i = 0; i < 64; ++i)
+        sty_pool_free(test_pool, objs[i]);
+    sty_pool_destroy(test_pool);
+}
+
+int
+main(void) {
+    test_threads_share(16, 0);
+    test_threads_share(48, STY_POOL_THREAD_CACHE);
+    test_threads_share(512, STY_POOL_THREAD_CACHE);
+    test_threads_share(100000, STY_POOL_THREAD_CACHE);
+    test_reuse();
+    test_exit();
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "test.h"
+#include <limits.h>
+
+/**
+ * 跨线程的释放与线程退出：由一个线程分配、另一个线程释放的对象最终回到所属的span，线程退出后
+ * 它缓存的对象被还回，计数并入统计，登记表中只剩下仍在运行的线程。
+ */
+
+#define TEST_ROUNDS     50
+#define TEST_BATCH      4000
+
+typedef struct test_queue {
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    void               *objs[TEST_BATCH];
+    int                 ready;
+} test_queue;
+
+static void *
+test_producer(void *arg) {
+    test_queue *q = (test_queue *)arg;
+    int i;
+    pthread_mutex_lock(&q->lock);
+    for (i = 0; i < TEST_BATCH; ++i) {
+        q->objs[i] = sty_alloc((size_t)(i % STY_CLASS_MAX) + 1);
+        test_fill(q->objs[i], (size_t)(i % STY_CLASS_MAX) + 1, (unsigned)i);
+    }
+    q->ready = 1;
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void *
+test_consumer(void *arg) {
+    test_queue *q = (test_queue *)arg;
+    int i;
+    pthread_mutex_lock(&q->lock);
+    while (!q->ready)
+        pthread_cond_wait(&q->cond, &q->lock);
+    for (i = 0; i < TEST_BATCH; ++i) {
+        TEST_CHECK(test_verify(q->objs[i], (size_t)(i % STY_CLASS_MAX) + 1, (unsigned)i));
+        if (i & 1)
+            sty_free(q->objs[i]);
+        else
+            sty_free_sized(q->objs[i], (size_t)(i % STY_CLASS_MAX) + 1);
+    }
+    q->ready = 0;
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void
+test_remote(void) {
+    test_queue q;
+    pthread_t producer, consumer;
+    int round;
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.cond, NULL);
+    q.ready = 0;
+    for (round = 0; round < TEST_ROUNDS; ++round) {
+        TEST_CHECK(pthread_create(&producer, NULL, test_producer, &q) == 0);
+        TEST_CHECK(pthread_create(&consumer, NULL, test_consumer, &q) == 0);
+        pthread_join(producer, NULL);
+        pthread_join(consumer, NULL);
+    }
+    TEST_CHECK(test_threads() == 1);
+    TEST_CHECK(test_live() == 0);
+}
+
+/* 线程退出前缓存的对象必须还回中心池，否则只由短命线程使用的span永远无法回到页源 */
+static void *
+test_churn(void *arg) {
+    void *objs[64];
+    int i;
+    (void)arg;
+    for (i = 0; i < 64; ++i)
+        objs[i] = sty_alloc(48);
+    for (i = 0; i < 64; ++i)
+        sty_free(objs[i]);
+    return NULL;
+}
+
+static void
+test_exit(void) {
+    sty_stats stats;
+    pthread_t threads[8];
+    size_t allocs = 0, cached = 0;
+    int round, i;
+    for (round = 0; round < 100; ++round) {
+        for (i = 0; i < 8; ++i)
+            TEST_CHECK(pthread_create(&threads[i], NULL, test_churn, NULL) == 0);
+        for (i = 0; i < 8; ++i)
+            pthread_join(threads[i], NULL);
+    }
+    /* 以STY_DEBUG编译时对象带着红区落在更大的类别中，所以汇总所有类别；主线程自己的缓存先清空 */
+    sty_thread_flush();
+    sty_stats_get(&stats);
+    for (i = 0; i < STY_STATS_CLASSES; ++i) {
+        allocs += stats.classes[i].allocs;
+        cached += stats.classes[i].thread_cached;
+    }
+    TEST_CHECK(stats.threads == 1);
+    TEST_CHECK(test_live() == 0);
+    TEST_CHECK(allocs >= 100 * 8 * 64);
+    TEST_CHECK(cached == 0);
+}
+
+/**
+ * sty的线程私有数据析构之后，同一线程仍可能分配与释放(例如glibc的__libc_thread_freeres)。测试的键在
+ * sty的键之后创建，它的析构函数因此在sty的之后运行，并且一直重新设置自己，直到pthread不再调用
+ * 析构函数为止，最后一轮中的分配与释放就发生在所有析构函数之后。依次创建的线程复用同一块线程
+ * 局部存储，析构之后的线程若重新登记，登记表中会留下已经退出的线程，甚至形成环。
+ */
+static pthread_key_t test_key;
+static sty_pool_t *test_pool;
+static _Thread_local int test_rounds;
+static int test_dummy;
+
+static void
+test_late(void *arg) {
+    void *objs[16];
+    int i;
+    if (arg != &test_dummy)
+        sty_free(arg);
+    for (i = 0; i < 16; ++i)
+        objs[i] = sty_alloc((size_t)i * 24);
+    for (i = 0; i < 16; i += 2)
+        sty_free(objs[i]);
+    for (i = 1; i < 16; i += 2)
+        sty_free_sized(objs[i], (size_t)i * 24);
+    sty_alloc_bulk(32, 16, objs);
+    sty_free_bulk(objs, 16);
+    sty_pool_free(test_pool, sty_pool_alloc(test_pool));
+    if (++test_rounds <= PTHREAD_DESTRUCTOR_ITERATIONS)
+        pthread_setspecific(test_key, &test_dummy);
+}
+
+static void *
+test_late_worker(void *arg) {
+    (void)arg;
+    sty_free(sty_alloc(64));
+    pthread_setspecific(test_key, sty_alloc(100));
+    return NULL;
+}
+
+static void
+test_after_exit(void) {
+    pthread_t thread;
+    size_t live;
+    int i;
+    /* 对象池的描述符本身是一个不会释放的小对象 */
+    test_pool = sty_pool_create(32, STY_POOL_THREAD_CACHE);
+    live = test_live();
+    TEST_CHECK(pthread_key_create(&test_key, test_late) == 0);
+    for (i = 0; i < 200; ++i) {
+        TEST_CHECK(pthread_create(&thread, NULL, test_late_worker, NULL) == 0);
+        pthread_join(thread, NULL);
+        TEST_CHECK(test_threads() == 1);
+    }
+    sty_thread_flush();
+    TEST_CHECK(test_live() == live);
+    sty_pool_destroy(test_pool);
+}
+
+int
+main(void) {
+    sty_free(sty_alloc(16));
+    test_remote();
+    test_exit();
+    test_after_exit();
+    return 0;
+}